@@ -0,0 +1,714 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vkf.hpp>
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t UPLOAD_BURST_SIZE = 64 * 1024;
+const uint32_t TEXTURE_SIZE = 256;
+
+static double elapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+struct Options {
+  std::string scene = "meshes";
+  uint32_t frames = 1000;
+  uint32_t warmupFrames = 10;
+  uint32_t count = 256;
+  uint32_t width = 800;
+  uint32_t height = 600;
+  bool headless = true;
+  bool cull = false;
+  std::string texturePath = "../assets/container.jpg";
+};
+
+// Timings of a single frame, in milliseconds
+struct FrameTimings {
+  double frame = 0.0;
+  double present = 0.0;
+  double uploads = 0.0;
+  double descriptors = 0.0;
+  double culling = 0.0;
+};
+
+class Samples {
+public:
+  void add(double sample) {
+    this->samples.push_back(sample);
+  }
+
+  double percentile(double p) const {
+    if (this->samples.empty()) {
+      return 0.0;
+    }
+
+    std::vector<double> sorted = this->samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+  }
+
+  double mean() const {
+    if (this->samples.empty()) {
+      return 0.0;
+    }
+
+    double sum = 0.0;
+    for (double sample : this->samples) {
+      sum += sample;
+    }
+    return sum / this->samples.size();
+  }
+
+  void writeJson(std::ostream &out) const {
+    out << "{\"mean\": " << this->mean()
+        << ", \"p50\": " << this->percentile(50.0)
+        << ", \"p90\": " << this->percentile(90.0)
+        << ", \"p99\": " << this->percentile(99.0)
+        << ", \"max\": " << this->percentile(100.0) << "}";
+  }
+
+private:
+  std::vector<double> samples;
+};
+
+// A scripted workload. update runs before present and draw runs inside it.
+class Scene {
+public:
+  Scene(vkf::Framework *framework) : framework(framework) {
+  }
+  virtual ~Scene() {
+  }
+
+  virtual void update(uint32_t frame, FrameTimings &timings) = 0;
+  virtual void draw(VkCommandBuffer commandBuffer) = 0;
+
+  // Recorded before the render pass begins
+  virtual void prePass(VkCommandBuffer commandBuffer) {
+  }
+
+  // Returns false if the scene detected a regression it checks for
+  virtual bool check(std::ostream &out) {
+    return true;
+  }
+
+protected:
+  vkf::Framework *framework;
+};
+
+// Draws count textured quads, updating their model matrices every frame. With
+// --cull only the quads inside the camera's frustum are updated and drawn.
+class MeshesScene : public Scene {
+public:
+  MeshesScene(vkf::Framework *framework, const Options &options)
+      : Scene(framework),
+        material(framework),
+        camera(framework),
+        cull(options.cull) {
+    std::vector<vkf::Vertex> vertices = {
+        {{-0.5, -0.5, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0}},
+        {{0.5, -0.5, 0.0}, {0.0, 1.0, 0.0}, {1.0, 0.0}},
+        {{0.5, 0.5, 0.0}, {0.0, 0.0, 1.0}, {1.0, 1.0}},
+        {{-0.5, 0.5, 0.0}, {0.0, 1.0, 1.0}, {0.0, 1.0}},
+    };
+    std::vector<uint32_t> indices = {0, 1, 2, 2, 3, 0};
+
+    for (uint32_t i = 0; i < options.count; i++) {
+      this->meshes.emplace_back(new vkf::Mesh(
+          &this->material, vertices, indices, options.texturePath.c_str()));
+    }
+    this->models.resize(this->meshes.size());
+    this->cullingSet.resize(this->meshes.size());
+
+    this->camera.setPos(glm::vec3(0.0f, 0.0f, -10.0f));
+  }
+
+  void update(uint32_t frame, FrameTimings &timings) override {
+    this->camera.update();
+
+    uint32_t side = static_cast<uint32_t>(
+        std::ceil(std::sqrt(static_cast<float>(this->meshes.size()))));
+
+    for (size_t i = 0; i < this->meshes.size(); i++) {
+      float x = static_cast<float>(i % side) - side / 2.0f;
+      float y = static_cast<float>(i / side) - side / 2.0f;
+
+      this->models[i] = glm::rotate(
+          glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f)),
+          frame * 0.01f,
+          glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    this->visible.clear();
+    if (this->cull) {
+      auto cullStart = Clock::now();
+
+      for (size_t i = 0; i < this->meshes.size(); i++) {
+        this->cullingSet.set(
+            i, this->meshes[i]->getBoundingSphere().transform(this->models[i]));
+      }
+      this->cullingSet.cull(this->camera.getFrustum(), this->visible);
+
+      timings.culling += elapsedMs(cullStart);
+    } else {
+      for (size_t i = 0; i < this->meshes.size(); i++) {
+        this->visible.push_back(static_cast<uint32_t>(i));
+      }
+    }
+
+    auto start = Clock::now();
+
+    this->framework->setCamera(
+        this->camera.getViewMatrix(), this->camera.getProjectionMatrix());
+    for (uint32_t i : this->visible) {
+      this->meshes[i]->setModel(this->models[i]);
+    }
+
+    timings.descriptors += elapsedMs(start);
+  }
+
+  void draw(VkCommandBuffer commandBuffer) override {
+    vkf::GpuProfiler *profiler = this->framework->getContext()->getProfiler();
+
+    profiler->beginScope(commandBuffer, "standard material");
+    this->material.bindPipeline(commandBuffer);
+    for (uint32_t i : this->visible) {
+      this->meshes[i]->draw(commandBuffer);
+    }
+    profiler->endScope(commandBuffer);
+  }
+
+protected:
+  vkf::StandardMaterial material;
+  vkf::PerspectiveCamera camera;
+  std::vector<std::unique_ptr<vkf::Mesh>> meshes;
+  std::vector<glm::mat4> models;
+
+  bool cull;
+  vkf::CullingSet cullingSet;
+  // Indices of the meshes drawn this frame
+  std::vector<uint32_t> visible;
+};
+
+// Draws the same quads as MeshesScene through a batch renderer, with one
+// indirect draw per texture instead of one draw per mesh. With --cull the
+// quads are culled on the GPU if the device supports it.
+class BatchedScene : public Scene {
+public:
+  BatchedScene(vkf::Framework *framework, const Options &options)
+      : Scene(framework),
+        material(framework),
+        renderer(framework, &this->material),
+        camera(framework) {
+    if (options.cull && this->renderer.isGpuCullingSupported()) {
+      this->renderer.setGpuCulling(true);
+      this->gpuCulling = true;
+    }
+
+    std::vector<vkf::Vertex> vertices = {
+        {{-0.5, -0.5, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0}},
+        {{0.5, -0.5, 0.0}, {0.0, 1.0, 0.0}, {1.0, 0.0}},
+        {{0.5, 0.5, 0.0}, {0.0, 0.0, 1.0}, {1.0, 1.0}},
+        {{-0.5, 0.5, 0.0}, {0.0, 1.0, 1.0}, {0.0, 1.0}},
+    };
+    std::vector<uint32_t> indices = {0, 1, 2, 2, 3, 0};
+
+    for (uint32_t i = 0; i < options.count; i++) {
+      this->meshes.emplace_back(new vkf::Mesh(
+          &this->material, vertices, indices, options.texturePath.c_str()));
+    }
+    this->models.resize(this->meshes.size());
+
+    this->camera.setPos(glm::vec3(0.0f, 0.0f, -10.0f));
+  }
+
+  void update(uint32_t frame, FrameTimings &timings) override {
+    this->camera.update();
+
+    auto start = Clock::now();
+
+    uint32_t side = static_cast<uint32_t>(
+        std::ceil(std::sqrt(static_cast<float>(this->meshes.size()))));
+
+    for (size_t i = 0; i < this->meshes.size(); i++) {
+      float x = static_cast<float>(i % side) - side / 2.0f;
+      float y = static_cast<float>(i / side) - side / 2.0f;
+
+      this->models[i] = glm::rotate(
+          glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f)),
+          frame * 0.01f,
+          glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    timings.descriptors += elapsedMs(start);
+  }
+
+  void prePass(VkCommandBuffer commandBuffer) override {
+    if (!this->gpuCulling) {
+      return;
+    }
+
+    vkf::GpuProfiler *profiler = this->framework->getContext()->getProfiler();
+
+    profiler->beginScope(commandBuffer, "culling");
+    this->queueDraws();
+    this->renderer.cull(commandBuffer);
+    profiler->endScope(commandBuffer);
+  }
+
+  void draw(VkCommandBuffer commandBuffer) override {
+    vkf::GpuProfiler *profiler = this->framework->getContext()->getProfiler();
+
+    profiler->beginScope(commandBuffer, "batch material");
+    if (!this->gpuCulling) {
+      this->queueDraws();
+    }
+    this->renderer.draw(commandBuffer);
+    profiler->endScope(commandBuffer);
+  }
+
+private:
+  vkf::BatchMaterial material;
+  vkf::BatchRenderer renderer;
+  vkf::PerspectiveCamera camera;
+  std::vector<std::unique_ptr<vkf::Mesh>> meshes;
+  std::vector<glm::mat4> models;
+  bool gpuCulling = false;
+
+  void queueDraws() {
+    this->renderer.setCamera(
+        this->camera.getViewMatrix(), this->camera.getProjectionMatrix());
+    for (size_t i = 0; i < this->meshes.size(); i++) {
+      this->renderer.add(*this->meshes[i], this->models[i]);
+    }
+  }
+};
+
+// Draws the same quads as MeshesScene as instances of a single mesh, with
+// one draw call
+class InstancedScene : public Scene {
+public:
+  InstancedScene(vkf::Framework *framework, const Options &options)
+      : Scene(framework), material(framework), camera(framework) {
+    std::vector<vkf::Vertex> vertices = {
+        {{-0.5, -0.5, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0}},
+        {{0.5, -0.5, 0.0}, {0.0, 1.0, 0.0}, {1.0, 0.0}},
+        {{0.5, 0.5, 0.0}, {0.0, 0.0, 1.0}, {1.0, 1.0}},
+        {{-0.5, 0.5, 0.0}, {0.0, 1.0, 1.0}, {0.0, 1.0}},
+    };
+    std::vector<uint32_t> indices = {0, 1, 2, 2, 3, 0};
+
+    this->mesh.reset(new vkf::Mesh(
+        &this->material, vertices, indices, options.texturePath.c_str()));
+    this->instances.resize(options.count);
+
+    this->camera.setPos(glm::vec3(0.0f, 0.0f, -10.0f));
+  }
+
+  void update(uint32_t frame, FrameTimings &timings) override {
+    this->camera.update();
+
+    auto start = Clock::now();
+
+    uint32_t side = static_cast<uint32_t>(
+        std::ceil(std::sqrt(static_cast<float>(this->instances.size()))));
+
+    for (size_t i = 0; i < this->instances.size(); i++) {
+      float x = static_cast<float>(i % side) - side / 2.0f;
+      float y = static_cast<float>(i / side) - side / 2.0f;
+
+      this->instances[i] = {
+          .transform = glm::rotate(
+              glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f)),
+              frame * 0.01f,
+              glm::vec3(0.0f, 0.0f, 1.0f)),
+          .tint = glm::vec3(1.0f),
+      };
+    }
+
+    this->framework->setCamera(
+        this->camera.getViewMatrix(), this->camera.getProjectionMatrix());
+
+    timings.descriptors += elapsedMs(start);
+  }
+
+  void draw(VkCommandBuffer commandBuffer) override {
+    vkf::GpuProfiler *profiler = this->framework->getContext()->getProfiler();
+
+    profiler->beginScope(commandBuffer, "instanced material");
+    this->material.bindPipeline(commandBuffer);
+    this->mesh->drawInstanced(
+        commandBuffer,
+        this->instances.data(),
+        static_cast<uint32_t>(this->instances.size()));
+    profiler->endScope(commandBuffer);
+  }
+
+private:
+  vkf::InstancedMaterial material;
+  vkf::PerspectiveCamera camera;
+  std::unique_ptr<vkf::Mesh> mesh;
+  std::vector<vkf::InstanceData> instances;
+};
+
+// Resizes the window every frame while drawing, the pipeline must survive
+// every resize
+class ResizeStormScene : public MeshesScene {
+public:
+  ResizeStormScene(vkf::Framework *framework, const Options &options)
+      : MeshesScene(framework, options),
+        width(options.width),
+        height(options.height),
+        initialRebuildCount(this->material.getPipelineRebuildCount()) {
+  }
+
+  void update(uint32_t frame, FrameTimings &timings) override {
+    uint32_t step = frame % 8;
+    this->framework->getWindow()->setSize(
+        this->width - step * 16, this->height - step * 8);
+
+    MeshesScene::update(frame, timings);
+  }
+
+  bool check(std::ostream &out) override {
+    // Counted by the material rather than by comparing handles, a rebuilt
+    // pipeline may get the same handle back from the driver
+    uint32_t pipelineRebuilds =
+        this->material.getPipelineRebuildCount() - this->initialRebuildCount;
+    out << ",\n  \"pipeline_rebuilds\": " << pipelineRebuilds;
+    return pipelineRebuilds == 0;
+  }
+
+private:
+  uint32_t width;
+  uint32_t height;
+  uint32_t initialRebuildCount;
+};
+
+// Draws the same quads as MeshesScene through a render queue, which sorts
+// them by state and skips the binds they share
+class QueuedScene : public MeshesScene {
+public:
+  QueuedScene(vkf::Framework *framework, const Options &options)
+      : MeshesScene(framework, options), queue(framework) {
+  }
+
+  void draw(VkCommandBuffer commandBuffer) override {
+    vkf::GpuProfiler *profiler = this->framework->getContext()->getProfiler();
+
+    glm::vec3 cameraPos = this->camera.getPos();
+    for (uint32_t i : this->visible) {
+      glm::vec3 pos = glm::vec3(this->models[i][3]);
+      this->queue.submit(
+          *this->meshes[i], this->models[i], glm::distance(cameraPos, pos));
+    }
+
+    profiler->beginScope(commandBuffer, "render queue");
+    this->queue.draw(commandBuffer);
+    profiler->endScope(commandBuffer);
+  }
+
+  bool check(std::ostream &out) override {
+    out << ",\n  \"pipeline_binds\": " << this->queue.getPipelineBindCount()
+        << ",\n  \"descriptor_set_binds\": "
+        << this->queue.getDescriptorSetBindCount()
+        << ",\n  \"vertex_buffer_binds\": "
+        << this->queue.getVertexBufferBindCount();
+    return true;
+  }
+
+private:
+  vkf::RenderQueue queue;
+};
+
+// Uploads count buffers of UPLOAD_BURST_SIZE bytes every frame
+class UploadBurstScene : public Scene {
+public:
+  UploadBurstScene(vkf::Framework *framework, const Options &options)
+      : Scene(framework), data(UPLOAD_BURST_SIZE, 0xAB) {
+    // Two sets of buffers are used in turns, so a set is only written again
+    // once its previous upload finished
+    for (auto &buffers : this->bufferSets) {
+      for (uint32_t i = 0; i < options.count; i++) {
+        buffers.emplace_back(framework, UPLOAD_BURST_SIZE);
+      }
+    }
+  }
+
+  ~UploadBurstScene() {
+    for (auto &buffers : this->bufferSets) {
+      for (auto &buffer : buffers) {
+        buffer.destroy();
+      }
+    }
+  }
+
+  void update(uint32_t frame, FrameTimings &timings) override {
+    auto start = Clock::now();
+
+    vkf::UploadQueue *uploadQueue = this->framework->getUploadQueue();
+
+    uint32_t set = frame % 2;
+    uploadQueue->wait(this->tickets[set]);
+
+    for (auto &buffer : this->bufferSets[set]) {
+      this->tickets[set] =
+          uploadQueue->enqueue(buffer, this->data.data(), this->data.size());
+    }
+
+    timings.uploads += elapsedMs(start);
+  }
+
+  void draw(VkCommandBuffer commandBuffer) override {
+  }
+
+private:
+  std::vector<unsigned char> data;
+  std::array<std::vector<vkf::VertexBuffer>, 2> bufferSets;
+  std::array<vkf::UploadTicket, 2> tickets{{0, 0}};
+};
+
+// Uploads count textures of TEXTURE_SIZE x TEXTURE_SIZE pixels every frame
+class TexturesScene : public Scene {
+public:
+  TexturesScene(vkf::Framework *framework, const Options &options)
+      : Scene(framework), data(TEXTURE_SIZE * TEXTURE_SIZE * 4) {
+    for (size_t i = 0; i < this->data.size(); i++) {
+      this->data[i] = static_cast<unsigned char>(i * 31);
+    }
+
+    for (auto &textures : this->textureSets) {
+      for (uint32_t i = 0; i < options.count; i++) {
+        textures.emplace_back(framework, TEXTURE_SIZE, TEXTURE_SIZE);
+      }
+    }
+  }
+
+  ~TexturesScene() {
+    for (auto &textures : this->textureSets) {
+      for (auto &texture : textures) {
+        texture.destroy();
+      }
+    }
+  }
+
+  void update(uint32_t frame, FrameTimings &timings) override {
+    auto start = Clock::now();
+
+    vkf::UploadQueue *uploadQueue = this->framework->getUploadQueue();
+
+    uint32_t set = frame % 2;
+    uploadQueue->wait(this->tickets[set]);
+
+    for (auto &texture : this->textureSets[set]) {
+      this->tickets[set] =
+          uploadQueue->enqueue(texture, this->data.data(), this->data.size());
+    }
+
+    timings.uploads += elapsedMs(start);
+  }
+
+  void draw(VkCommandBuffer commandBuffer) override {
+  }
+
+private:
+  std::vector<unsigned char> data;
+  std::array<std::vector<vkf::Texture>, 2> textureSets;
+  std::array<vkf::UploadTicket, 2> tickets{{0, 0}};
+};
+
+static void printUsage() {
+  std::cerr
+      << "Usage: vkf_bench [options]\n"
+      << "  --scene <meshes|batched|instanced|queued|textures|"
+      << "resize_storm|upload_burst>\n"
+      << "  --frames <n>     Number of measured frames (default 1000)\n"
+      << "  --warmup <n>     Unmeasured frames run first (default 10)\n"
+      << "  --count <n>      Number of meshes, textures or buffers (default "
+         "256)\n"
+      << "  --size <w> <h>   Window size (default 800 600)\n"
+      << "  --texture <path> Texture used by the mesh scenes\n"
+      << "  --cull           Frustum cull the mesh scenes, the batched scene "
+         "on the GPU\n"
+      << "  --windowed       Render to a window instead of offscreen"
+      << std::endl;
+}
+
+static bool parseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (arg == "--scene" && hasValue) {
+      options->scene = argv[++i];
+    } else if (arg == "--frames" && hasValue) {
+      options->frames = std::stoul(argv[++i]);
+    } else if (arg == "--warmup" && hasValue) {
+      options->warmupFrames = std::stoul(argv[++i]);
+    } else if (arg == "--count" && hasValue) {
+      options->count = std::stoul(argv[++i]);
+    } else if (arg == "--size" && i + 2 < argc) {
+      options->width = std::stoul(argv[++i]);
+      options->height = std::stoul(argv[++i]);
+    } else if (arg == "--texture" && hasValue) {
+      options->texturePath = argv[++i];
+    } else if (arg == "--cull") {
+      options->cull = true;
+    } else if (arg == "--windowed") {
+      options->headless = false;
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static std::unique_ptr<Scene>
+createScene(vkf::Framework *framework, const Options &options) {
+  if (options.scene == "meshes") {
+    return std::unique_ptr<Scene>(new MeshesScene(framework, options));
+  }
+  if (options.scene == "batched") {
+    return std::unique_ptr<Scene>(new BatchedScene(framework, options));
+  }
+  if (options.scene == "instanced") {
+    return std::unique_ptr<Scene>(new InstancedScene(framework, options));
+  }
+  if (options.scene == "queued") {
+    return std::unique_ptr<Scene>(new QueuedScene(framework, options));
+  }
+  if (options.scene == "textures") {
+    return std::unique_ptr<Scene>(new TexturesScene(framework, options));
+  }
+  if (options.scene == "resize_storm") {
+    return std::unique_ptr<Scene>(new ResizeStormScene(framework, options));
+  }
+  if (options.scene == "upload_burst") {
+    return std::unique_ptr<Scene>(new UploadBurstScene(framework, options));
+  }
+  return nullptr;
+}
+
+static std::unique_ptr<vkf::Framework> createFramework(const Options &options) {
+  if (options.headless) {
+    return std::unique_ptr<vkf::Framework>(
+        new vkf::Framework(options.width, options.height));
+  }
+  return std::unique_ptr<vkf::Framework>(
+      new vkf::Framework("vkf_bench", options.width, options.height));
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    printUsage();
+    return 1;
+  }
+
+  auto framework = createFramework(options);
+  auto window = framework->getWindow();
+  auto context = framework->getContext();
+
+  auto setupStart = Clock::now();
+
+  auto scene = createScene(framework.get(), options);
+  if (scene == nullptr) {
+    printUsage();
+    return 1;
+  }
+
+  // Everything created during setup is resident before measuring
+  framework->getTextureLoader()->waitIdle();
+  framework->getUploadQueue()->wait(framework->getUploadQueue()->flush());
+
+  double setupMs = elapsedMs(setupStart);
+
+  Samples frameSamples;
+  Samples presentSamples;
+  Samples uploadSamples;
+  Samples descriptorSamples;
+  Samples cullingSamples;
+
+  uint64_t framebufferCreationCount = 0;
+
+  uint32_t totalFrames = options.warmupFrames + options.frames;
+  for (uint32_t frame = 0; frame < totalFrames; frame++) {
+    if (frame == options.warmupFrames) {
+      framebufferCreationCount = context->getFramebufferCreationCount();
+    }
+
+    FrameTimings timings;
+    auto frameStart = Clock::now();
+
+    window->pollEvents();
+
+    scene->update(frame, timings);
+
+    auto uploadStart = Clock::now();
+    framework->update();
+    timings.uploads += elapsedMs(uploadStart);
+
+    auto presentStart = Clock::now();
+    context->present(
+        [&](VkCommandBuffer commandBuffer) { scene->draw(commandBuffer); },
+        [&](VkCommandBuffer commandBuffer) { scene->prePass(commandBuffer); });
+    timings.present = elapsedMs(presentStart);
+
+    timings.frame = elapsedMs(frameStart);
+
+    if (frame >= options.warmupFrames) {
+      frameSamples.add(timings.frame);
+      presentSamples.add(timings.present);
+      uploadSamples.add(timings.uploads);
+      descriptorSamples.add(timings.descriptors);
+      cullingSamples.add(timings.culling);
+    }
+  }
+
+  framebufferCreationCount =
+      context->getFramebufferCreationCount() - framebufferCreationCount;
+
+  std::ostream &out = std::cout;
+  out << "{\n";
+  out << "  \"scene\": \"" << options.scene << "\",\n";
+  out << "  \"count\": " << options.count << ",\n";
+  out << "  \"frames\": " << options.frames << ",\n";
+  out << "  \"headless\": " << (options.headless ? "true" : "false") << ",\n";
+  out << "  \"width\": " << options.width << ",\n";
+  out << "  \"height\": " << options.height << ",\n";
+  out << "  \"setup_ms\": " << setupMs << ",\n";
+  out << "  \"frame_ms\": ";
+  frameSamples.writeJson(out);
+  out << ",\n  \"present_ms\": ";
+  presentSamples.writeJson(out);
+  out << ",\n  \"uploads_ms\": ";
+  uploadSamples.writeJson(out);
+  out << ",\n  \"descriptors_ms\": ";
+  descriptorSamples.writeJson(out);
+  out << ",\n  \"culling_ms\": ";
+  cullingSamples.writeJson(out);
+  out << ",\n  \"gpu_ms\": {";
+  const char *separator = "";
+  for (const auto &average : context->getProfiler()->getAverages()) {
+    out << separator << "\"" << average.first << "\": " << average.second;
+    separator = ", ";
+  }
+  out << "}";
+  out << ",\n  \"framebuffers_created\": " << framebufferCreationCount;
+  bool passed = scene->check(out);
+  out << "\n}" << std::endl;
+
+  vkDeviceWaitIdle(context->getDevice());
+  scene.reset();
+
+  return passed ? 0 : 2;
+}
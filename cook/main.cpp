@@ -0,0 +1,94 @@
+#include "obj_parser.hpp"
+#include "pack_writer.hpp"
+#include <iostream>
+#include <stb_image.h>
+#include <stdexcept>
+#include <string>
+
+struct Options {
+  std::string outputPath;
+  std::vector<std::string> inputPaths;
+};
+
+static void printUsage() {
+  std::cerr
+      << "Usage: vkf_cook -o <pack> <inputs...>\n"
+      << "  Images are stored as RGBA with a full mip chain, .obj files as\n"
+      << "  interleaved vertices and 32 bit indices. Every asset is named\n"
+      << "  after its file name, e.g. \"container.jpg\"." << std::endl;
+}
+
+static bool parseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if (arg == "-o" && i + 1 < argc) {
+      options->outputPath = argv[++i];
+    } else if (!arg.empty() && arg[0] != '-') {
+      options->inputPaths.push_back(arg);
+    } else {
+      return false;
+    }
+  }
+
+  return !options->outputPath.empty() && !options->inputPaths.empty();
+}
+
+static std::string getFileName(const std::string &path) {
+  size_t slash = path.find_last_of("/\\");
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static bool isObjPath(const std::string &path) {
+  return path.size() >= 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+}
+
+static void cook(PackWriter &writer, const std::string &path) {
+  std::string name = getFileName(path);
+
+  if (isObjPath(path)) {
+    std::vector<vkf::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    loadObjFile(path.c_str(), &vertices, &indices);
+
+    writer.addMesh(name, vertices, indices);
+    return;
+  }
+
+  int width, height, components;
+  unsigned char *pixels =
+      stbi_load(path.c_str(), &width, &height, &components, STBI_rgb_alpha);
+
+  if (pixels == nullptr) {
+    throw std::runtime_error("Failed to load image " + path);
+  }
+
+  writer.addTexture(
+      name,
+      static_cast<uint32_t>(width),
+      static_cast<uint32_t>(height),
+      pixels);
+
+  stbi_image_free(pixels);
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    printUsage();
+    return 1;
+  }
+
+  try {
+    PackWriter writer;
+    for (const std::string &path : options.inputPaths) {
+      cook(writer, path);
+    }
+    writer.write(options.outputPath.c_str());
+  } catch (const std::exception &e) {
+    std::cerr << "vkf_cook: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "obj_parser.hpp"
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Converts a 1 based, possibly negative OBJ index into a 0 based one
+static int resolveIndex(int index, size_t count) {
+  if (index < 0) {
+    index += static_cast<int>(count);
+  } else {
+    index -= 1;
+  }
+
+  if (index < 0 || static_cast<size_t>(index) >= count) {
+    throw std::runtime_error("OBJ face index is out of range");
+  }
+
+  return index;
+}
+
+void loadObjFile(
+    const char *path,
+    std::vector<vkf::Vertex> *vertices,
+    std::vector<uint32_t> *indices) {
+  std::ifstream file(path);
+  if (file.fail()) {
+    throw std::runtime_error("Failed to open OBJ file");
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords;
+
+  // Maps a (position, texture coordinate) pair to its vertex index
+  std::map<std::pair<int, int>, uint32_t> uniqueVertices;
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    std::string keyword;
+    stream >> keyword;
+
+    if (keyword == "v") {
+      glm::vec3 position;
+      stream >> position.x >> position.y >> position.z;
+      positions.push_back(position);
+    } else if (keyword == "vt") {
+      glm::vec2 texCoord;
+      stream >> texCoord.x >> texCoord.y;
+      // OBJ has the origin at the bottom left, Vulkan at the top left
+      texCoord.y = 1.0f - texCoord.y;
+      texCoords.push_back(texCoord);
+    } else if (keyword == "f") {
+      std::vector<uint32_t> face;
+
+      std::string corner;
+      while (stream >> corner) {
+        // Corners are "v", "v/vt", "v//vn" or "v/vt/vn"
+        int positionIndex = resolveIndex(std::stoi(corner), positions.size());
+        int texCoordIndex = -1;
+
+        size_t slash = corner.find('/');
+        if (slash != std::string::npos && slash + 1 < corner.size() &&
+            corner[slash + 1] != '/') {
+          texCoordIndex = resolveIndex(
+              std::stoi(corner.substr(slash + 1)), texCoords.size());
+        }
+
+        auto key = std::make_pair(positionIndex, texCoordIndex);
+        auto it = uniqueVertices.find(key);
+        if (it == uniqueVertices.end()) {
+          vkf::Vertex vertex = {
+              .pos = positions[positionIndex],
+              .color = glm::vec3(1.0f),
+              .texCoord = texCoordIndex == -1 ? glm::vec2(0.0f)
+                                              : texCoords[texCoordIndex],
+          };
+
+          it = uniqueVertices
+                   .emplace(key, static_cast<uint32_t>(vertices->size()))
+                   .first;
+          vertices->push_back(vertex);
+        }
+
+        face.push_back(it->second);
+      }
+
+      for (size_t i = 2; i < face.size(); i++) {
+        indices->push_back(face[0]);
+        indices->push_back(face[i - 1]);
+        indices->push_back(face[i]);
+      }
+    }
+  }
+}
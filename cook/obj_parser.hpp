@@ -0,0 +1,12 @@
+#pragma once
+
+#include <mesh/vertex.hpp>
+#include <vector>
+
+// Loads the positions and texture coordinates of a Wavefront OBJ file.
+// Polygons are triangulated as fans and vertices sharing the same position
+// and texture coordinate are merged.
+void loadObjFile(
+    const char *path,
+    std::vector<vkf::Vertex> *vertices,
+    std::vector<uint32_t> *indices);
@@ -0,0 +1,157 @@
+#include "pack_writer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+// Halves an RGBA image, averaging every 2x2 block. Odd edges reuse their last
+// row or column.
+static std::vector<unsigned char> downsample(
+    const std::vector<unsigned char> &pixels, uint32_t width, uint32_t height) {
+  uint32_t halfWidth = std::max(width / 2, 1u);
+  uint32_t halfHeight = std::max(height / 2, 1u);
+
+  std::vector<unsigned char> result(halfWidth * halfHeight * 4);
+
+  for (uint32_t y = 0; y < halfHeight; y++) {
+    uint32_t y0 = std::min(y * 2, height - 1);
+    uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+    for (uint32_t x = 0; x < halfWidth; x++) {
+      uint32_t x0 = std::min(x * 2, width - 1);
+      uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+      for (uint32_t c = 0; c < 4; c++) {
+        uint32_t sum = pixels[(y0 * width + x0) * 4 + c] +
+                       pixels[(y0 * width + x1) * 4 + c] +
+                       pixels[(y1 * width + x0) * 4 + c] +
+                       pixels[(y1 * width + x1) * 4 + c];
+        result[(y * halfWidth + x) * 4 + c] =
+            static_cast<unsigned char>((sum + 2) / 4);
+      }
+    }
+  }
+
+  return result;
+}
+
+PackWriter::PackWriter() {
+  // Room for the header, which is filled in once every entry was added
+  this->data.resize(sizeof(vkf::AssetPackHeader));
+}
+
+void PackWriter::addTexture(
+    const std::string &name,
+    uint32_t width,
+    uint32_t height,
+    const unsigned char *pixels) {
+  vkf::AssetPackEntry &entry = this->beginEntry(name, vkf::ASSET_TYPE_TEXTURE);
+
+  // Stored in the same channel order as the image format, so levels are
+  // copied into the image without any conversion
+  entry.format = VK_FORMAT_R8G8B8A8_UNORM;
+  entry.width = width;
+  entry.height = height;
+
+  std::vector<unsigned char> level(
+      pixels, pixels + static_cast<size_t>(width) * height * 4);
+  uint32_t levelWidth = width;
+  uint32_t levelHeight = height;
+
+  while (true) {
+    this->append(level.data(), level.size());
+    entry.mipLevels++;
+
+    if (levelWidth == 1 && levelHeight == 1) {
+      break;
+    }
+
+    level = downsample(level, levelWidth, levelHeight);
+    levelWidth = std::max(levelWidth / 2, 1u);
+    levelHeight = std::max(levelHeight / 2, 1u);
+  }
+
+  entry.size = this->data.size() - entry.offset;
+}
+
+void PackWriter::addMesh(
+    const std::string &name,
+    const std::vector<vkf::Vertex> &vertices,
+    const std::vector<uint32_t> &indices) {
+  vkf::AssetPackEntry &entry = this->beginEntry(name, vkf::ASSET_TYPE_MESH);
+
+  entry.vertexCount = static_cast<uint32_t>(vertices.size());
+  entry.indexCount = static_cast<uint32_t>(indices.size());
+
+  this->append(vertices.data(), vertices.size() * sizeof(vkf::Vertex));
+  this->align(sizeof(uint32_t));
+
+  entry.indexOffset = this->data.size() - entry.offset;
+  this->append(indices.data(), indices.size() * sizeof(uint32_t));
+
+  entry.size = this->data.size() - entry.offset;
+}
+
+void PackWriter::write(const char *path) {
+  this->align(alignof(vkf::AssetPackEntry));
+
+  vkf::AssetPackHeader header = {
+      .magic = vkf::ASSET_PACK_MAGIC,
+      .version = vkf::ASSET_PACK_VERSION,
+      .entryCount = static_cast<uint32_t>(this->entries.size()),
+      .reserved = 0,
+      .entryTableOffset = this->data.size(),
+  };
+  memcpy(this->data.data(), &header, sizeof(header));
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (file.fail()) {
+    throw std::runtime_error("Failed to create asset pack");
+  }
+
+  file.write(
+      reinterpret_cast<const char *>(this->data.data()), this->data.size());
+  file.write(
+      reinterpret_cast<const char *>(this->entries.data()),
+      this->entries.size() * sizeof(vkf::AssetPackEntry));
+
+  if (file.fail()) {
+    throw std::runtime_error("Failed to write asset pack");
+  }
+}
+
+vkf::AssetPackEntry &
+PackWriter::beginEntry(const std::string &name, vkf::AssetType type) {
+  if (name.size() >= vkf::ASSET_PACK_NAME_SIZE) {
+    throw std::runtime_error("Asset name is too long: " + name);
+  }
+
+  for (const auto &entry : this->entries) {
+    if (name == entry.name) {
+      throw std::runtime_error("Duplicate asset name: " + name);
+    }
+  }
+
+  this->align(vkf::ASSET_PACK_ALIGNMENT);
+
+  vkf::AssetPackEntry entry = {};
+  strncpy(entry.name, name.c_str(), vkf::ASSET_PACK_NAME_SIZE - 1);
+  entry.type = type;
+  entry.offset = this->data.size();
+
+  this->entries.push_back(entry);
+  return this->entries.back();
+}
+
+void PackWriter::align(uint64_t alignment) {
+  size_t remainder = this->data.size() % alignment;
+  if (remainder != 0) {
+    this->data.resize(this->data.size() + alignment - remainder, 0);
+  }
+}
+
+void PackWriter::append(const void *bytes, size_t size) {
+  const unsigned char *begin = static_cast<const unsigned char *>(bytes);
+  this->data.insert(this->data.end(), begin, begin + size);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <asset/asset_pack_format.hpp>
+#include <mesh/vertex.hpp>
+#include <string>
+#include <vector>
+
+// Builds an asset pack in memory and writes it out in one go
+class PackWriter {
+public:
+  PackWriter();
+
+  // Adds a tightly packed RGBA texture, and every level of its mip chain
+  // downsampled with a box filter
+  void addTexture(
+      const std::string &name,
+      uint32_t width,
+      uint32_t height,
+      const unsigned char *pixels);
+
+  void addMesh(
+      const std::string &name,
+      const std::vector<vkf::Vertex> &vertices,
+      const std::vector<uint32_t> &indices);
+
+  void write(const char *path);
+
+private:
+  std::vector<unsigned char> data;
+  std::vector<vkf::AssetPackEntry> entries;
+
+  // Starts a new entry whose data begins at the next aligned offset
+  vkf::AssetPackEntry &beginEntry(const std::string &name, vkf::AssetType type);
+
+  // Pads the data with zeros until its size is a multiple of alignment
+  void align(uint64_t alignment);
+
+  void append(const void *bytes, size_t size);
+};
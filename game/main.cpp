@@ -45,6 +45,8 @@ int main() {
 
   vkf::Mesh mesh{&material, vertices, indices, "../assets/container.jpg"};
 
+  vkf::RenderQueue renderQueue{&framework};
+
   window->setRelativeMouse(true);
 
   while (!window->getShouldClose()) {
@@ -60,16 +62,18 @@ int main() {
 
     camera.update();
 
-    vkf::UniformBufferObject ubo{
-        .model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f)),
-        .view = camera.getViewMatrix(),
-        .proj = camera.getProjectionMatrix(),
-    };
-    mesh.updateUniformDescriptor(ubo);
+    framework.update();
+
+    framework.setCamera(camera.getViewMatrix(), camera.getProjectionMatrix());
+
+    glm::vec3 pos = glm::vec3(0.0f, 0.0f, 0.0f);
+    renderQueue.submit(
+        mesh,
+        glm::translate(glm::mat4(1.0f), pos),
+        glm::distance(camera.getPos(), pos));
 
     context->present([&](VkCommandBuffer commandBuffer) {
-      material.bindPipeline(commandBuffer);
-      mesh.draw(commandBuffer);
+      renderQueue.draw(commandBuffer);
     });
   }
 
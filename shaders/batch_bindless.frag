@@ -0,0 +1,17 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 color;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) flat in uint textureIndex;
+
+layout(location = 0) out vec4 outColor;
+
+// The framework's texture table
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+void main() {
+  // Draws of a multi-draw call may select different textures
+  outColor = texture(textures[nonuniformEXT(textureIndex)], texCoord) *
+             vec4(color, 1.0);
+}
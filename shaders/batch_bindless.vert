@@ -0,0 +1,30 @@
+#version 450
+
+// Written once per frame by the batch renderer. Every draw's firstInstance is
+// its index into models.
+layout(set = 0, binding = 1) readonly buffer drawBuffer {
+  mat4 view;
+  mat4 proj;
+  mat4 models[];
+};
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 texCoord;
+// Per draw, selected by firstInstance like the model matrix
+layout(location = 3) in uint textureIndex;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+layout(location = 0) out vec3 color0;
+layout(location = 1) out vec2 texCoord0;
+layout(location = 2) flat out uint textureIndex0;
+
+void main() {
+  gl_Position = proj * view * models[gl_InstanceIndex] * vec4(pos, 1.0);
+  color0 = color;
+  texCoord0 = texCoord;
+  textureIndex0 = textureIndex;
+}
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 color;
+layout(location = 1) in vec2 texCoord;
+
+layout(location = 0) out vec4 outColor;
+
+// The framework's texture table
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform pushConstants {
+  mat4 model;
+  uint drawIndex;
+  uint textureIndex;
+};
+
+void main() {
+  outColor = texture(textures[textureIndex], texCoord) * vec4(color, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 450
+
+// The framework's camera, shared by every mesh
+layout(set = 0, binding = 1) uniform cameraBuffer {
+  mat4 view;
+  mat4 proj;
+};
+
+layout(push_constant) uniform pushConstants {
+  mat4 model;
+  uint drawIndex;
+  uint textureIndex;
+};
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 texCoord;
+
+// Per instance, applied before the mesh's model matrix
+layout(location = 3) in mat4 instanceTransform;
+layout(location = 7) in vec3 instanceTint;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+layout(location = 0) out vec3 color0;
+layout(location = 1) out vec2 texCoord0;
+
+void main() {
+  gl_Position = proj * view * model * instanceTransform * vec4(pos, 1.0);
+  color0 = color * instanceTint;
+  texCoord0 = texCoord;
+}
@@ -1,11 +1,17 @@
 #version 450
 
-layout(set = 0, binding = 1) uniform uniformBuffer {
-  mat4 model;
+// The framework's camera, shared by every mesh
+layout(set = 0, binding = 1) uniform cameraBuffer {
   mat4 view;
   mat4 proj;
 };
 
+layout(push_constant) uniform pushConstants {
+  mat4 model;
+  uint drawIndex;
+  uint textureIndex;
+};
+
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec2 texCoord;
@@ -0,0 +1,153 @@
+#include "asset_pack.hpp"
+#include "../framework/framework.hpp"
+#include "../mesh/vertex.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace vkf;
+
+AssetPack::AssetPack(Framework *framework, const char *path)
+    : framework(framework), file(path) {
+  if (this->file.getSize() < sizeof(AssetPackHeader)) {
+    throw std::runtime_error("Invalid asset pack");
+  }
+
+  const AssetPackHeader *header =
+      reinterpret_cast<const AssetPackHeader *>(this->file.getData());
+
+  if (header->magic != ASSET_PACK_MAGIC) {
+    throw std::runtime_error("Invalid asset pack");
+  }
+
+  if (header->version != ASSET_PACK_VERSION) {
+    throw std::runtime_error("Unsupported asset pack version");
+  }
+
+  uint64_t tableSize =
+      static_cast<uint64_t>(header->entryCount) * sizeof(AssetPackEntry);
+  if (header->entryTableOffset % alignof(AssetPackEntry) != 0 ||
+      header->entryTableOffset > this->file.getSize() ||
+      tableSize > this->file.getSize() - header->entryTableOffset) {
+    throw std::runtime_error("Invalid asset pack entry table");
+  }
+
+  this->entries = reinterpret_cast<const AssetPackEntry *>(
+      this->file.getData() + header->entryTableOffset);
+
+  for (uint32_t i = 0; i < header->entryCount; i++) {
+    const AssetPackEntry &entry = this->entries[i];
+
+    if (entry.offset > this->file.getSize() ||
+        entry.size > this->file.getSize() - entry.offset) {
+      throw std::runtime_error("Asset pack entry is out of bounds");
+    }
+
+    std::string name(
+        entry.name, strnlen(entry.name, ASSET_PACK_NAME_SIZE));
+    this->entryIndices[name] = i;
+  }
+}
+
+bool AssetPack::contains(const char *name, AssetType type) const {
+  auto it = this->entryIndices.find(name);
+  return it != this->entryIndices.end() &&
+         this->entries[it->second].type == type;
+}
+
+const AssetPackEntry &
+AssetPack::getEntry(const char *name, AssetType type) const {
+  auto it = this->entryIndices.find(name);
+  if (it == this->entryIndices.end()) {
+    throw std::runtime_error("Asset not found in pack");
+  }
+
+  const AssetPackEntry &entry = this->entries[it->second];
+  if (entry.type != type) {
+    throw std::runtime_error("Asset in pack has the wrong type");
+  }
+
+  return entry;
+}
+
+const unsigned char *AssetPack::getData(const AssetPackEntry &entry) const {
+  return this->file.getData() + entry.offset;
+}
+
+UploadTicket AssetPack::loadTexture(const char *name, Texture &texture) {
+  const AssetPackEntry &entry = this->getEntry(name, ASSET_TYPE_TEXTURE);
+
+  std::vector<TextureLevel> levels = getTextureLevels(entry);
+  if (levels.back().offset + levels.back().size > entry.size) {
+    throw std::runtime_error("Asset pack texture is smaller than its levels");
+  }
+
+  texture = {
+      this->framework,
+      entry.width,
+      entry.height,
+      static_cast<VkFormat>(entry.format),
+      entry.mipLevels,
+  };
+
+  return this->framework->getUploadQueue()->enqueue(
+      texture, this->getData(entry), entry.size, levels);
+}
+
+UploadTicket
+AssetPack::loadMesh(const char *name, GeometryHandle *geometry) {
+  const AssetPackEntry &entry = this->getEntry(name, ASSET_TYPE_MESH);
+
+  size_t verticesSize = entry.vertexCount * sizeof(Vertex);
+  size_t indicesSize = entry.indexCount * sizeof(uint32_t);
+  if (verticesSize > entry.indexOffset ||
+      entry.indexOffset + indicesSize > entry.size) {
+    throw std::runtime_error("Asset pack mesh is smaller than its contents");
+  }
+
+  const unsigned char *data = this->getData(entry);
+
+  UploadTicket uploadTicket;
+  *geometry = this->framework->getGeometryPool()->allocate(
+      reinterpret_cast<const Vertex *>(data),
+      entry.vertexCount,
+      reinterpret_cast<const uint32_t *>(data + entry.indexOffset),
+      entry.indexCount,
+      &uploadTicket);
+
+  return uploadTicket;
+}
+
+std::vector<TextureLevel>
+AssetPack::getTextureLevels(const AssetPackEntry &entry) {
+  // vkf_cook only writes 4 byte per texel formats
+  if (entry.format != VK_FORMAT_R8G8B8A8_UNORM &&
+      entry.format != VK_FORMAT_R8G8B8A8_SRGB) {
+    throw std::runtime_error("Unsupported asset pack texture format");
+  }
+
+  if (entry.mipLevels == 0) {
+    throw std::runtime_error("Asset pack texture has no levels");
+  }
+
+  std::vector<TextureLevel> levels;
+
+  size_t offset = 0;
+  uint32_t levelWidth = entry.width;
+  uint32_t levelHeight = entry.height;
+  for (uint32_t i = 0; i < entry.mipLevels; i++) {
+    TextureLevel level = {
+        .offset = offset,
+        .size = static_cast<size_t>(levelWidth) * levelHeight * 4,
+        .width = levelWidth,
+        .height = levelHeight,
+    };
+    levels.push_back(level);
+
+    offset += level.size;
+    levelWidth = std::max(levelWidth / 2, 1u);
+    levelHeight = std::max(levelHeight / 2, 1u);
+  }
+
+  return levels;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../buffer/geometry_pool.hpp"
+#include "../buffer/upload_queue.hpp"
+#include "../io/mapped_file.hpp"
+#include "asset_pack_format.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vkf {
+class Framework;
+
+// Asset pack written by vkf_cook. The pack is memory mapped, and uploads read
+// their ranges straight from the mapping into the staging buffer, without
+// decoding or intermediate copies.
+class AssetPack {
+public:
+  AssetPack(Framework *framework, const char *path);
+  AssetPack(const AssetPack &) = delete;
+  AssetPack &operator=(const AssetPack &) = delete;
+  ~AssetPack(){};
+
+  // Returns true if the pack has an entry with the given name and type
+  bool contains(const char *name, AssetType type) const;
+
+  // Returns the entry with the given name, throws if it doesn't exist or
+  // isn't of the given type
+  const AssetPackEntry &getEntry(const char *name, AssetType type) const;
+
+  // Returns the start of an entry's data inside the mapping
+  const unsigned char *getData(const AssetPackEntry &entry) const;
+
+  // Creates the texture described by a texture entry and records the upload
+  // of all of its levels
+  UploadTicket loadTexture(const char *name, Texture &texture);
+
+  // Allocates a mesh entry's vertices and indices from the geometry pool and
+  // records their upload
+  UploadTicket loadMesh(const char *name, GeometryHandle *geometry);
+
+  // Returns where every level of a texture entry is located inside its data
+  static std::vector<TextureLevel> getTextureLevels(
+      const AssetPackEntry &entry);
+
+private:
+  Framework *framework{nullptr};
+
+  MappedFile file;
+
+  const AssetPackEntry *entries{nullptr};
+  std::map<std::string, uint32_t> entryIndices;
+};
+} // namespace vkf
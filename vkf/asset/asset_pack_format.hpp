@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of asset packs, shared by the runtime reader and vkf_cook.
+// A pack is a header, followed by the data of every entry and by the entry
+// table. All integers are little endian.
+namespace vkf {
+const uint32_t ASSET_PACK_MAGIC = 0x50414b56; // "VKAP"
+
+// Bumped whenever the layout changes, packs with another version are rejected
+const uint32_t ASSET_PACK_VERSION = 1;
+
+// Alignment of every entry's data inside the pack, enough for any buffer to
+// image copy offset so ranges can be staged as they are
+const uint64_t ASSET_PACK_ALIGNMENT = 256;
+
+// Maximum length of an entry's name, including the terminating null
+const uint32_t ASSET_PACK_NAME_SIZE = 64;
+
+enum AssetType : uint32_t {
+  ASSET_TYPE_TEXTURE = 1,
+  ASSET_TYPE_MESH = 2,
+};
+
+struct AssetPackHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t reserved;
+  uint64_t entryTableOffset;
+};
+
+struct AssetPackEntry {
+  char name[ASSET_PACK_NAME_SIZE];
+  uint32_t type;
+
+  // Textures: a VkFormat and the size of the first level. Levels are stored
+  // one after the other, from the largest to the smallest.
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipLevels;
+
+  // Meshes: interleaved vkf::Vertex data, followed by 32 bit indices at
+  // indexOffset bytes from the start of the entry's data
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t reserved;
+  uint64_t indexOffset;
+
+  // Range of the entry's data, relative to the start of the pack
+  uint64_t offset;
+  uint64_t size;
+};
+} // namespace vkf
@@ -0,0 +1,108 @@
+#include "free_list_allocator.hpp"
+#include <stdexcept>
+
+using namespace vkf;
+
+FreeListAllocator::FreeListAllocator(uint64_t size) : size(size) {
+  this->reset(0);
+}
+
+bool FreeListAllocator::allocate(uint64_t size, uint64_t *offset) {
+  if (size == 0) {
+    *offset = 0;
+    return true;
+  }
+
+  auto bestFit = this->rangesBySize.lower_bound(size);
+  if (bestFit == this->rangesBySize.end()) {
+    return false;
+  }
+
+  uint64_t rangeOffset = bestFit->second;
+  uint64_t rangeSize = bestFit->first;
+
+  this->eraseRange(this->rangesByOffset.find(rangeOffset));
+  if (rangeSize > size) {
+    this->insertRange(rangeOffset + size, rangeSize - size);
+  }
+
+  this->freeSize -= size;
+  *offset = rangeOffset;
+  return true;
+}
+
+void FreeListAllocator::free(uint64_t offset, uint64_t size) {
+  if (size == 0) {
+    return;
+  }
+
+  if (offset + size > this->size) {
+    throw std::runtime_error("Freed a range outside of the allocator");
+  }
+
+  this->freeSize += size;
+
+  // Merge with the free range after this one
+  auto next = this->rangesByOffset.find(offset + size);
+  if (next != this->rangesByOffset.end()) {
+    size += next->second;
+    this->eraseRange(next);
+  }
+
+  // Merge with the free range before this one
+  auto previous = this->rangesByOffset.lower_bound(offset);
+  if (previous != this->rangesByOffset.begin()) {
+    --previous;
+    if (previous->first + previous->second == offset) {
+      offset = previous->first;
+      size += previous->second;
+      this->eraseRange(previous);
+    }
+  }
+
+  this->insertRange(offset, size);
+}
+
+void FreeListAllocator::reset(uint64_t usedSize) {
+  this->rangesByOffset.clear();
+  this->rangesBySize.clear();
+
+  this->freeSize = this->size - usedSize;
+  if (this->freeSize > 0) {
+    this->insertRange(usedSize, this->freeSize);
+  }
+}
+
+uint64_t FreeListAllocator::getSize() const {
+  return this->size;
+}
+
+uint64_t FreeListAllocator::getFreeSize() const {
+  return this->freeSize;
+}
+
+uint64_t FreeListAllocator::getLargestFreeRange() const {
+  if (this->rangesBySize.empty()) {
+    return 0;
+  }
+
+  return this->rangesBySize.rbegin()->first;
+}
+
+void FreeListAllocator::insertRange(uint64_t offset, uint64_t size) {
+  this->rangesByOffset[offset] = size;
+  this->rangesBySize.emplace(size, offset);
+}
+
+void FreeListAllocator::eraseRange(
+    std::map<uint64_t, uint64_t>::iterator it) {
+  auto range = this->rangesBySize.equal_range(it->second);
+  for (auto sizeIt = range.first; sizeIt != range.second; ++sizeIt) {
+    if (sizeIt->second == it->first) {
+      this->rangesBySize.erase(sizeIt);
+      break;
+    }
+  }
+
+  this->rangesByOffset.erase(it);
+}
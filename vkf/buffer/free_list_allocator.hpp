@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+namespace vkf {
+// Hands out ranges of an abstract address space, e.g. elements of a buffer.
+// Free ranges are kept sorted by offset, so neighbours are merged when freed,
+// and by size, so allocations take the smallest range they fit in.
+class FreeListAllocator {
+public:
+  FreeListAllocator(uint64_t size);
+
+  // Reserves size units, returns false if no free range is large enough
+  bool allocate(uint64_t size, uint64_t *offset);
+
+  // Returns a range obtained from allocate
+  void free(uint64_t offset, uint64_t size);
+
+  // Marks [0, usedSize) as allocated and everything after it as free, e.g.
+  // after the allocations were compacted
+  void reset(uint64_t usedSize);
+
+  uint64_t getSize() const;
+  uint64_t getFreeSize() const;
+  uint64_t getLargestFreeRange() const;
+
+private:
+  uint64_t size = 0;
+  uint64_t freeSize = 0;
+
+  // Offset to size
+  std::map<uint64_t, uint64_t> rangesByOffset;
+  // Size to offset
+  std::multimap<uint64_t, uint64_t> rangesBySize;
+
+  void insertRange(uint64_t offset, uint64_t size);
+  void eraseRange(std::map<uint64_t, uint64_t>::iterator it);
+};
+} // namespace vkf
@@ -0,0 +1,306 @@
+#include "geometry_pool.hpp"
+#include "../framework/framework.hpp"
+#include <algorithm>
+
+using namespace vkf;
+
+GeometryPool::GeometryPool(
+    Framework *framework, uint32_t vertexCapacity, uint32_t indexCapacity)
+    : framework(framework),
+      vertexBuffer(framework, vertexCapacity * sizeof(Vertex)),
+      indexBuffer(framework, indexCapacity * sizeof(uint32_t)),
+      vertexAllocator(vertexCapacity),
+      indexAllocator(indexCapacity) {
+}
+
+void GeometryPool::destroy() {
+  this->indexBuffer.destroy();
+  this->vertexBuffer.destroy();
+}
+
+GeometryHandle GeometryPool::allocate(
+    const Vertex *vertices,
+    uint32_t vertexCount,
+    const uint32_t *indices,
+    uint32_t indexCount,
+    UploadTicket *uploadTicket) {
+  if (vertexCount == 0 || indexCount == 0) {
+    throw std::runtime_error("Can't allocate empty geometry");
+  }
+
+  GeometryRange range;
+  if (!this->reserve(vertexCount, indexCount, &range)) {
+    if (vertexCount > this->vertexAllocator.getFreeSize() ||
+        indexCount > this->indexAllocator.getFreeSize()) {
+      throw std::runtime_error("Geometry pool is full");
+    }
+
+    // There's enough space, just not in one piece
+    this->defragment();
+
+    if (!this->reserve(vertexCount, indexCount, &range)) {
+      throw std::runtime_error("Geometry pool is full");
+    }
+  }
+
+  GeometryHandle handle;
+  if (!this->freeHandles.empty()) {
+    handle = this->freeHandles.back();
+    this->freeHandles.pop_back();
+  } else {
+    this->allocations.emplace_back();
+    handle = static_cast<GeometryHandle>(this->allocations.size());
+  }
+
+  Allocation &allocation = this->allocations[handle - 1];
+  allocation.range = range;
+  allocation.used = true;
+
+  UploadQueue *uploadQueue = this->framework->getUploadQueue();
+
+  uploadQueue->enqueue(
+      this->vertexBuffer,
+      vertices,
+      vertexCount * sizeof(Vertex),
+      range.vertexOffset * sizeof(Vertex));
+  *uploadTicket = uploadQueue->enqueue(
+      this->indexBuffer,
+      indices,
+      indexCount * sizeof(uint32_t),
+      range.firstIndex * sizeof(uint32_t));
+
+  return handle;
+}
+
+void GeometryPool::free(GeometryHandle handle) {
+  if (handle == 0) {
+    return;
+  }
+
+  this->pendingFrees.push_back({
+      .handle = handle,
+      .frameNumber = this->framework->getContext()->getFrameNumber(),
+  });
+}
+
+GeometryRange GeometryPool::getRange(GeometryHandle handle) const {
+  return this->allocations[handle - 1].range;
+}
+
+VkBuffer GeometryPool::getVertexBuffer() {
+  return this->vertexBuffer.getHandle();
+}
+
+VkBuffer GeometryPool::getIndexBuffer() {
+  return this->indexBuffer.getHandle();
+}
+
+void GeometryPool::bind(VkCommandBuffer commandBuffer) {
+  VkDeviceSize offset = 0;
+  VkBuffer vertexBufferHandle = this->vertexBuffer.getHandle();
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBufferHandle, &offset);
+  vkCmdBindIndexBuffer(
+      commandBuffer, this->indexBuffer.getHandle(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryPool::defragment() {
+  VkContext *context = this->framework->getContext();
+  UploadQueue *uploadQueue = this->framework->getUploadQueue();
+
+  // Nothing may read or write the old buffers anymore
+  uploadQueue->wait(uploadQueue->flush());
+  vkDeviceWaitIdle(context->getDevice());
+
+  for (const auto &pendingFree : this->pendingFrees) {
+    this->release(pendingFree.handle);
+  }
+  this->pendingFrees.clear();
+
+  // Allocations are moved in the order they're laid out in, so their
+  // relative order is kept
+  std::vector<Allocation *> sortedAllocations;
+  for (auto &allocation : this->allocations) {
+    if (allocation.used) {
+      sortedAllocations.push_back(&allocation);
+    }
+  }
+  std::sort(
+      sortedAllocations.begin(),
+      sortedAllocations.end(),
+      [](const Allocation *a, const Allocation *b) {
+        return a->range.vertexOffset < b->range.vertexOffset;
+      });
+
+  std::vector<VkBufferCopy> vertexCopies;
+  std::vector<VkBufferCopy> indexCopies;
+  uint32_t vertexHead = 0;
+  uint32_t indexHead = 0;
+
+  for (Allocation *allocation : sortedAllocations) {
+    GeometryRange &range = allocation->range;
+
+    if (range.vertexCount > 0) {
+      vertexCopies.push_back({
+          .srcOffset = range.vertexOffset * sizeof(Vertex),
+          .dstOffset = vertexHead * sizeof(Vertex),
+          .size = range.vertexCount * sizeof(Vertex),
+      });
+    }
+
+    if (range.indexCount > 0) {
+      indexCopies.push_back({
+          .srcOffset = range.firstIndex * sizeof(uint32_t),
+          .dstOffset = indexHead * sizeof(uint32_t),
+          .size = range.indexCount * sizeof(uint32_t),
+      });
+    }
+
+    range.vertexOffset = vertexHead;
+    range.firstIndex = indexHead;
+    vertexHead += range.vertexCount;
+    indexHead += range.indexCount;
+  }
+
+  VertexBuffer newVertexBuffer{
+      this->framework, this->vertexAllocator.getSize() * sizeof(Vertex)};
+  IndexBuffer newIndexBuffer{
+      this->framework, this->indexAllocator.getSize() * sizeof(uint32_t)};
+
+  context->useTransientCommandBuffer([&](VkCommandBuffer commandBuffer) {
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to begin defragmentation commands");
+    }
+
+    if (!vertexCopies.empty()) {
+      vkCmdCopyBuffer(
+          commandBuffer,
+          this->vertexBuffer.getHandle(),
+          newVertexBuffer.getHandle(),
+          static_cast<uint32_t>(vertexCopies.size()),
+          vertexCopies.data());
+    }
+
+    if (!indexCopies.empty()) {
+      vkCmdCopyBuffer(
+          commandBuffer,
+          this->indexBuffer.getHandle(),
+          newIndexBuffer.getHandle(),
+          static_cast<uint32_t>(indexCopies.size()),
+          indexCopies.data());
+    }
+
+    VkMemoryBarrier memoryBarrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                         VK_ACCESS_INDEX_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        0,
+        1,
+        &memoryBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to record defragmentation commands");
+    }
+
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    if (vkQueueSubmit(
+            context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to submit defragmentation commands");
+    }
+
+    vkQueueWaitIdle(context->getGraphicsQueue());
+  });
+
+  this->vertexBuffer.destroy();
+  this->indexBuffer.destroy();
+  this->vertexBuffer = newVertexBuffer;
+  this->indexBuffer = newIndexBuffer;
+
+  this->vertexAllocator.reset(vertexHead);
+  this->indexAllocator.reset(indexHead);
+}
+
+uint32_t GeometryPool::getFreeVertexCount() const {
+  return static_cast<uint32_t>(this->vertexAllocator.getFreeSize());
+}
+
+uint32_t GeometryPool::getFreeIndexCount() const {
+  return static_cast<uint32_t>(this->indexAllocator.getFreeSize());
+}
+
+void GeometryPool::update() {
+  VkContext *context = this->framework->getContext();
+
+  auto it = this->pendingFrees.begin();
+  while (it != this->pendingFrees.end() &&
+         context->isFrameComplete(it->frameNumber)) {
+    this->release(it->handle);
+    ++it;
+  }
+
+  this->pendingFrees.erase(this->pendingFrees.begin(), it);
+}
+
+void GeometryPool::release(GeometryHandle handle) {
+  Allocation &allocation = this->allocations[handle - 1];
+
+  this->vertexAllocator.free(
+      allocation.range.vertexOffset, allocation.range.vertexCount);
+  this->indexAllocator.free(
+      allocation.range.firstIndex, allocation.range.indexCount);
+
+  allocation.used = false;
+  this->freeHandles.push_back(handle);
+}
+
+bool GeometryPool::reserve(
+    uint32_t vertexCount, uint32_t indexCount, GeometryRange *range) {
+  uint64_t vertexOffset, indexOffset;
+
+  if (!this->vertexAllocator.allocate(vertexCount, &vertexOffset)) {
+    return false;
+  }
+
+  if (!this->indexAllocator.allocate(indexCount, &indexOffset)) {
+    this->vertexAllocator.free(vertexOffset, vertexCount);
+    return false;
+  }
+
+  *range = {
+      .vertexOffset = static_cast<uint32_t>(vertexOffset),
+      .vertexCount = vertexCount,
+      .firstIndex = static_cast<uint32_t>(indexOffset),
+      .indexCount = indexCount,
+  };
+  return true;
+}
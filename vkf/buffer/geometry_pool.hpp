@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../mesh/vertex.hpp"
+#include "free_list_allocator.hpp"
+#include "index_buffer.hpp"
+#include "upload_queue.hpp"
+#include "vertex_buffer.hpp"
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+
+// Identifies an allocation of the geometry pool, 0 is never used
+typedef uint32_t GeometryHandle;
+
+// Location of a mesh's data inside the geometry pool's buffers, in elements,
+// so it can be passed to vkCmdDrawIndexed as it is
+struct GeometryRange {
+  uint32_t vertexOffset;
+  uint32_t vertexCount;
+  uint32_t firstIndex;
+  uint32_t indexCount;
+};
+
+// Shared vertex and index buffers that meshes sub-allocate their data from,
+// so drawing many meshes doesn't need rebinding buffers in between.
+// Allocations are referred to by handles, as defragmenting moves their data.
+class GeometryPool {
+public:
+  GeometryPool(
+      Framework *framework, uint32_t vertexCapacity, uint32_t indexCapacity);
+  GeometryPool(const GeometryPool &) = delete;
+  GeometryPool &operator=(const GeometryPool &) = delete;
+  ~GeometryPool(){};
+
+  void destroy();
+
+  // Reserves room for the vertices and indices and records their upload.
+  // Defragments the pool if it has enough free space, just not in one piece.
+  // Throws if the data doesn't fit or is empty.
+  GeometryHandle allocate(
+      const Vertex *vertices,
+      uint32_t vertexCount,
+      const uint32_t *indices,
+      uint32_t indexCount,
+      UploadTicket *uploadTicket);
+
+  // Returns the allocation's space to the pool once the frames in flight
+  // are done with it
+  void free(GeometryHandle handle);
+
+  GeometryRange getRange(GeometryHandle handle) const;
+
+  VkBuffer getVertexBuffer();
+  VkBuffer getIndexBuffer();
+
+  // Binds the pool's vertex buffer to binding 0, and its index buffer
+  void bind(VkCommandBuffer commandBuffer);
+
+  // Moves every allocation to the start of freshly created buffers, leaving
+  // all of the free space in one piece. Waits for the device to be idle.
+  void defragment();
+
+  uint32_t getFreeVertexCount() const;
+  uint32_t getFreeIndexCount() const;
+
+  // Returns the space of freed allocations that no frame in flight uses
+  // anymore to the pool. Called by Framework::update.
+  void update();
+
+private:
+  Framework *framework{nullptr};
+
+  VertexBuffer vertexBuffer;
+  IndexBuffer indexBuffer;
+
+  FreeListAllocator vertexAllocator;
+  FreeListAllocator indexAllocator;
+
+  struct Allocation {
+    GeometryRange range;
+    bool used = false;
+  };
+
+  // Indexed by handle - 1
+  std::vector<Allocation> allocations;
+  std::vector<GeometryHandle> freeHandles;
+
+  struct PendingFree {
+    GeometryHandle handle;
+    // Frame number at which the allocation was freed
+    uint64_t frameNumber;
+  };
+
+  std::vector<PendingFree> pendingFrees;
+
+  // Returns the allocation's ranges to the allocators and its handle to the
+  // free handles
+  void release(GeometryHandle handle);
+
+  // Reserves a range in both allocators, returns false if either is full
+  bool reserve(uint32_t vertexCount, uint32_t indexCount, GeometryRange *range);
+};
+} // namespace vkf
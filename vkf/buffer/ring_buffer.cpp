@@ -0,0 +1,89 @@
+#include "ring_buffer.hpp"
+#include "../framework/framework.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace vkf;
+
+RingBuffer::RingBuffer(
+    Framework *framework, size_t frameSize, VkBufferUsageFlags usage)
+    : Buffer(framework) {
+  const VkPhysicalDeviceLimits &limits =
+      this->framework->getContext()->getPhysicalDeviceProperties().limits;
+
+  if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+    this->alignment = std::max(
+        this->alignment,
+        static_cast<size_t>(limits.minUniformBufferOffsetAlignment));
+  }
+
+  if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+    this->alignment = std::max(
+        this->alignment,
+        static_cast<size_t>(limits.minStorageBufferOffsetAlignment));
+  }
+
+  // Keep every frame's region aligned as well
+  this->frameSize =
+      (frameSize + this->alignment - 1) / this->alignment * this->alignment;
+
+  VkBufferCreateInfo bufferCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size = this->frameSize * MAX_FRAMES_IN_FLIGHT,
+      .usage = usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = 0,
+      .pQueueFamilyIndices = nullptr,
+  };
+
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  VmaAllocationInfo allocationInfo;
+  if (vmaCreateBuffer(
+          this->framework->getContext()->getAllocator(),
+          &bufferCreateInfo,
+          &allocInfo,
+          &this->buffer,
+          &this->allocation,
+          &allocationInfo) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create ring buffer");
+  }
+
+  this->mappedData = allocationInfo.pMappedData;
+}
+
+uint32_t RingBuffer::allocate(const void *data, size_t size) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  VkContext *context = this->framework->getContext();
+
+  if (this->frameNumber != context->getFrameNumber()) {
+    // Make sure the GPU isn't reading this region anymore before reusing it
+    context->waitForCurrentFrame();
+    this->frameNumber = context->getFrameNumber();
+    this->head = 0;
+  }
+
+  size_t offset =
+      (this->head + this->alignment - 1) / this->alignment * this->alignment;
+  if (offset + size > this->frameSize) {
+    throw std::runtime_error("Ring buffer frame region is full");
+  }
+  this->head = offset + size;
+
+  offset += static_cast<size_t>(context->getCurrentFrame()) * this->frameSize;
+
+  memcpy(static_cast<char *>(this->mappedData) + offset, data, size);
+
+  return static_cast<uint32_t>(offset);
+}
+
+size_t RingBuffer::getFrameSize() const {
+  return this->frameSize;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "buffer.hpp"
+#include <mutex>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+
+// Host visible, persistently mapped buffer with one region per frame in
+// flight. Allocations are only valid until the end of the frame they were
+// made in.
+class RingBuffer : public Buffer {
+public:
+  RingBuffer(Framework *framework, size_t frameSize, VkBufferUsageFlags usage);
+  ~RingBuffer(){};
+
+  // Copies data into the current frame's region and returns its offset from
+  // the start of the buffer
+  uint32_t allocate(const void *data, size_t size);
+
+  size_t getFrameSize() const;
+
+private:
+  size_t frameSize = 0;
+  size_t alignment = 1;
+  void *mappedData{nullptr};
+
+  uint64_t frameNumber = UINT64_MAX;
+  size_t head = 0;
+  std::mutex mutex;
+};
+} // namespace vkf
@@ -1,41 +1,39 @@
 #pragma once
 
-#include "../texture/texture.hpp"
 #include "buffer.hpp"
-#include "index_buffer.hpp"
-#include "uniform_buffer.hpp"
-#include "vertex_buffer.hpp"
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
 namespace vkf {
 class Framework;
 
+// Persistently mapped buffer used as the source of uploads. Regions are
+// handed out in a ring and must be released in the order they were allocated.
 class StagingBuffer : public Buffer {
 public:
   StagingBuffer(Framework *framework, size_t size);
   ~StagingBuffer(){};
 
-  // Copies memory into the staging buffer
-  void copyMemory(void *data, size_t size);
+  // Reserves a region of the buffer, returns false if there isn't enough
+  // contiguous free space left
+  bool allocate(size_t size, size_t alignment, VkDeviceSize *offset);
 
-  // Issues a command to transfer this buffer's memory into a vertex buffer
-  void transfer(VertexBuffer &buffer, size_t size);
+  // Releases every region allocated before the given end offset
+  void release(VkDeviceSize end);
 
-  // Issues a command to transfer this buffer's memory into an index buffer
-  void transfer(IndexBuffer &buffer, size_t size);
+  // Returns the offset right after the last allocated region
+  VkDeviceSize getHead() const;
 
-  // Issues a command to transfer this buffer's memory into a uniform buffer
-  void transfer(UniformBuffer &buffer, size_t size);
-
-  // Issues a command to transfer this buffer's memory into a texture's image
-  void transfer(Texture &texture);
+  void *getMappedData();
+  size_t getSize() const;
 
 private:
-  void innerBufferTransfer(
-      Buffer &buffer,
-      size_t size,
-      VkAccessFlags dstAccessMask,
-      VkPipelineStageFlags dstStageMask);
+  size_t size = 0;
+  void *mappedData{nullptr};
+
+  VkDeviceSize head = 0;
+  VkDeviceSize tail = 0;
+  // Whether the allocated regions wrap around the end of the buffer
+  bool wrapped = false;
 };
 } // namespace vkf
@@ -0,0 +1,32 @@
+#include "storage_buffer.hpp"
+#include "../framework/framework.hpp"
+
+using namespace vkf;
+
+StorageBuffer::StorageBuffer(
+    Framework *framework, size_t size, VkBufferUsageFlags usage)
+    : Buffer(framework) {
+  VkBufferCreateInfo bufferCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size = size,
+      .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = 0,
+      .pQueueFamilyIndices = nullptr,
+  };
+
+  VmaAllocationCreateInfo allocInfo = {};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  if (vmaCreateBuffer(
+          this->framework->getContext()->getAllocator(),
+          &bufferCreateInfo,
+          &allocInfo,
+          &this->buffer,
+          &this->allocation,
+          nullptr) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create storage buffer");
+  }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "buffer.hpp"
+
+namespace vkf {
+// Device local buffer written and read by shaders. usage is added to the
+// storage buffer usage, e.g. to also read it as indirect draw commands.
+class StorageBuffer : public Buffer {
+public:
+  StorageBuffer(Framework *framework, size_t size, VkBufferUsageFlags usage);
+};
+} // namespace vkf
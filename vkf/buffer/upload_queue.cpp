@@ -0,0 +1,800 @@
+#include "upload_queue.hpp"
+#include "../framework/framework.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace vkf;
+
+// Alignment of every region allocated in the staging buffer, enough for
+// buffer copies and for copies into images of up to 16 byte texels
+const size_t STAGING_ALIGNMENT = 16;
+
+UploadQueue::UploadQueue(Framework *framework) : framework(framework) {
+  VkContext *context = this->framework->getContext();
+
+  this->transferOwnership = context->getTransferQueueFamilyIndex() !=
+                            context->getGraphicsQueueFamilyIndex();
+
+  this->commandPool =
+      this->createCommandPool(context->getTransferQueueFamilyIndex());
+
+  if (this->transferOwnership) {
+    this->acquireCommandPool =
+        this->createCommandPool(context->getGraphicsQueueFamilyIndex());
+  }
+
+  this->timeline.create(
+      context->getDevice(), context->isTimelineSemaphoreSupported());
+
+  this->currentBatch.ticket = 1;
+}
+
+UploadQueue::~UploadQueue() {
+  VkDevice device = this->framework->getContext()->getDevice();
+
+  if (device != VK_NULL_HANDLE) {
+    vkDeviceWaitIdle(device);
+
+    auto destroyBatch = [&](const Batch &batch) {
+      if (batch.semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(device, batch.semaphore, nullptr);
+      }
+    };
+
+    for (const auto &batch : this->submittedBatches) {
+      destroyBatch(batch);
+    }
+
+    for (const auto &batch : this->freeBatches) {
+      destroyBatch(batch);
+    }
+
+    destroyBatch(this->currentBatch);
+
+    this->timeline.destroy();
+
+    // Also frees the command buffers
+    if (this->acquireCommandPool != VK_NULL_HANDLE) {
+      vkDestroyCommandPool(device, this->acquireCommandPool, nullptr);
+      this->acquireCommandPool = VK_NULL_HANDLE;
+    }
+
+    if (this->commandPool != VK_NULL_HANDLE) {
+      vkDestroyCommandPool(device, this->commandPool, nullptr);
+      this->commandPool = VK_NULL_HANDLE;
+    }
+  }
+}
+
+UploadTicket UploadQueue::enqueue(
+    VertexBuffer &buffer,
+    const void *data,
+    size_t size,
+    VkDeviceSize dstOffset) {
+  return this->enqueueBuffer(
+      buffer,
+      data,
+      size,
+      dstOffset,
+      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+}
+
+UploadTicket UploadQueue::enqueue(
+    IndexBuffer &buffer,
+    const void *data,
+    size_t size,
+    VkDeviceSize dstOffset) {
+  return this->enqueueBuffer(
+      buffer,
+      data,
+      size,
+      dstOffset,
+      VK_ACCESS_INDEX_READ_BIT,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+}
+
+UploadTicket
+UploadQueue::enqueue(UniformBuffer &buffer, const void *data, size_t size) {
+  return this->enqueueBuffer(
+      buffer,
+      data,
+      size,
+      0,
+      VK_ACCESS_UNIFORM_READ_BIT,
+      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+}
+
+UploadTicket
+UploadQueue::enqueue(Texture &texture, const void *data, size_t size) {
+  VkDeviceSize offset = this->stage(data, size, STAGING_ALIGNMENT);
+
+  this->recordTextureCopies(
+      texture,
+      offset,
+      {{
+          .offset = 0,
+          .size = size,
+          .width = texture.getWidth(),
+          .height = texture.getHeight(),
+      }});
+
+  VkImageSubresourceRange imageSubresourceRange = {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .baseMipLevel = 0,
+      .levelCount = texture.getMipLevels(),
+      .baseArrayLayer = 0,
+      .layerCount = 1,
+  };
+
+  if (texture.getMipLevels() == 1) {
+    this->releaseImage(
+        texture.getImageHandle(),
+        imageSubresourceRange,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    return this->currentBatch.ticket;
+  }
+
+  // Blits need a graphics queue, so the mips are generated after the image
+  // was handed over to the graphics queue family
+  this->releaseImage(
+      texture.getImageHandle(),
+      imageSubresourceRange,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+  this->generateMipmaps(
+      this->transferOwnership ? this->currentBatch.acquireCommandBuffer
+                              : this->currentBatch.commandBuffer,
+      texture);
+
+  return this->currentBatch.ticket;
+}
+
+UploadTicket UploadQueue::enqueue(
+    Texture &texture,
+    const void *data,
+    size_t size,
+    const std::vector<TextureLevel> &levels) {
+  if (levels.size() != texture.getMipLevels()) {
+    throw std::runtime_error(
+        "Texture data doesn't have one level per mip level");
+  }
+
+  VkDeviceSize offset = this->stage(data, size, STAGING_ALIGNMENT);
+
+  this->recordTextureCopies(texture, offset, levels);
+
+  VkImageSubresourceRange imageSubresourceRange = {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .baseMipLevel = 0,
+      .levelCount = texture.getMipLevels(),
+      .baseArrayLayer = 0,
+      .layerCount = 1,
+  };
+
+  this->releaseImage(
+      texture.getImageHandle(),
+      imageSubresourceRange,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+  return this->currentBatch.ticket;
+}
+
+void UploadQueue::recordTextureCopies(
+    Texture &texture,
+    VkDeviceSize offset,
+    const std::vector<TextureLevel> &levels) {
+  VkCommandBuffer commandBuffer = this->getCommandBuffer();
+
+  VkImageSubresourceRange imageSubresourceRange = {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .baseMipLevel = 0,
+      .levelCount = texture.getMipLevels(),
+      .baseArrayLayer = 0,
+      .layerCount = 1,
+  };
+
+  VkImageMemoryBarrier imageMemoryBarrierFromUndefinedToTransferDst = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = texture.getImageHandle(),
+      .subresourceRange = imageSubresourceRange,
+  };
+
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &imageMemoryBarrierFromUndefinedToTransferDst);
+
+  std::vector<VkBufferImageCopy> bufferImageCopyInfos;
+  for (uint32_t i = 0; i < levels.size(); i++) {
+    bufferImageCopyInfos.push_back({
+        .bufferOffset = offset + levels[i].offset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = i,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .imageOffset =
+            {
+                .x = 0,
+                .y = 0,
+                .z = 0,
+            },
+        .imageExtent =
+            {
+                .width = levels[i].width,
+                .height = levels[i].height,
+                .depth = 1,
+            },
+    });
+  }
+
+  vkCmdCopyBufferToImage(
+      commandBuffer,
+      this->framework->getStagingBuffer()->getHandle(),
+      texture.getImageHandle(),
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      static_cast<uint32_t>(bufferImageCopyInfos.size()),
+      bufferImageCopyInfos.data());
+}
+
+void UploadQueue::generateMipmaps(
+    VkCommandBuffer commandBuffer, Texture &texture) {
+  VkImageMemoryBarrier imageMemoryBarrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = texture.getImageHandle(),
+      .subresourceRange =
+          {
+              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+              .baseMipLevel = 0,
+              .levelCount = 1,
+              .baseArrayLayer = 0,
+              .layerCount = 1,
+          },
+  };
+
+  int32_t width = static_cast<int32_t>(texture.getWidth());
+  int32_t height = static_cast<int32_t>(texture.getHeight());
+
+  for (uint32_t level = 1; level < texture.getMipLevels(); level++) {
+    // The previous level was written, by the copy or the last blit
+    imageMemoryBarrier.subresourceRange.baseMipLevel = level - 1;
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &imageMemoryBarrier);
+
+    int32_t levelWidth = std::max(width / 2, 1);
+    int32_t levelHeight = std::max(height / 2, 1);
+
+    VkImageBlit imageBlit = {
+        .srcSubresource =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level - 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .srcOffsets = {{0, 0, 0}, {width, height, 1}},
+        .dstSubresource =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .dstOffsets = {{0, 0, 0}, {levelWidth, levelHeight, 1}},
+    };
+
+    vkCmdBlitImage(
+        commandBuffer,
+        texture.getImageHandle(),
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        texture.getImageHandle(),
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &imageBlit,
+        VK_FILTER_LINEAR);
+
+    // The previous level is done
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &imageMemoryBarrier);
+
+    width = levelWidth;
+    height = levelHeight;
+  }
+
+  // The last level is only ever written
+  imageMemoryBarrier.subresourceRange.baseMipLevel =
+      texture.getMipLevels() - 1;
+  imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &imageMemoryBarrier);
+}
+
+UploadTicket UploadQueue::flush() {
+  if (this->currentBatch.commandBuffer != VK_NULL_HANDLE) {
+    VkContext *context = this->framework->getContext();
+
+    if (vkEndCommandBuffer(this->currentBatch.commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to record upload command buffer");
+    }
+
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &this->currentBatch.commandBuffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    if (this->transferOwnership) {
+      // The graphics queue waits for the copies before acquiring the
+      // resources, and the acquire submission signals the timeline instead
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores = &this->currentBatch.semaphore;
+
+      if (vkQueueSubmit(
+              context->getTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit upload command buffer");
+      }
+
+      if (vkEndCommandBuffer(this->currentBatch.acquireCommandBuffer) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("Failed to record acquire command buffer");
+      }
+
+      VkPipelineStageFlags waitDstStageMask =
+          VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+      submitInfo.waitSemaphoreCount = 1;
+      submitInfo.pWaitSemaphores = &this->currentBatch.semaphore;
+      submitInfo.pWaitDstStageMask = &waitDstStageMask;
+      submitInfo.pCommandBuffers = &this->currentBatch.acquireCommandBuffer;
+      submitInfo.signalSemaphoreCount = 0;
+      submitInfo.pSignalSemaphores = nullptr;
+
+      if (this->timeline.submit(
+              context->getGraphicsQueue(),
+              submitInfo,
+              this->currentBatch.ticket) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit acquire command buffer");
+      }
+    } else {
+      if (this->timeline.submit(
+              context->getTransferQueue(),
+              submitInfo,
+              this->currentBatch.ticket) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit upload command buffer");
+      }
+    }
+
+    this->submittedBatches.push_back(this->currentBatch);
+
+    UploadTicket nextTicket = this->currentBatch.ticket + 1;
+    this->currentBatch = Batch{};
+    this->currentBatch.ticket = nextTicket;
+  }
+
+  this->collect(false);
+
+  return this->currentBatch.ticket - 1;
+}
+
+bool UploadQueue::isComplete(UploadTicket ticket) {
+  if (ticket <= this->completedTicket) {
+    return true;
+  }
+
+  // The current batch wasn't submitted, so it can't have signaled yet
+  return ticket < this->currentBatch.ticket &&
+         this->timeline.isComplete(ticket);
+}
+
+void UploadQueue::wait(UploadTicket ticket) {
+  if (ticket >= this->currentBatch.ticket) {
+    this->flush();
+  }
+
+  while (this->completedTicket < ticket && !this->submittedBatches.empty()) {
+    this->collect(true);
+  }
+}
+
+VkDeviceSize
+UploadQueue::stage(const void *data, size_t size, size_t alignment) {
+  StagingBuffer *stagingBuffer = this->framework->getStagingBuffer();
+
+  VkDeviceSize offset;
+  while (!stagingBuffer->allocate(size, alignment, &offset)) {
+    // Submit what we have and wait for the oldest batch to free up space
+    if (this->currentBatch.commandBuffer != VK_NULL_HANDLE) {
+      this->flush();
+      continue;
+    }
+
+    if (this->submittedBatches.empty()) {
+      throw std::runtime_error("Upload doesn't fit in the staging buffer");
+    }
+
+    this->collect(true);
+  }
+
+  memcpy(
+      static_cast<char *>(stagingBuffer->getMappedData()) + offset,
+      data,
+      size);
+
+  this->currentBatch.stagingEnd = stagingBuffer->getHead();
+
+  return offset;
+}
+
+VkCommandBuffer UploadQueue::getCommandBuffer() {
+  if (this->currentBatch.commandBuffer != VK_NULL_HANDLE) {
+    return this->currentBatch.commandBuffer;
+  }
+
+  VkDevice device = this->framework->getContext()->getDevice();
+
+  if (!this->freeBatches.empty()) {
+    const Batch &freeBatch = this->freeBatches.back();
+    this->currentBatch.commandBuffer = freeBatch.commandBuffer;
+    this->currentBatch.acquireCommandBuffer = freeBatch.acquireCommandBuffer;
+    this->currentBatch.semaphore = freeBatch.semaphore;
+    this->freeBatches.pop_back();
+  } else {
+    VkCommandBufferAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = this->commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    if (vkAllocateCommandBuffers(
+            device, &allocateInfo, &this->currentBatch.commandBuffer) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to allocate upload command buffer");
+    }
+
+    if (this->transferOwnership) {
+      allocateInfo.commandPool = this->acquireCommandPool;
+
+      if (vkAllocateCommandBuffers(
+              device,
+              &allocateInfo,
+              &this->currentBatch.acquireCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate acquire command buffer");
+      }
+
+      VkSemaphoreCreateInfo semaphoreCreateInfo = {
+          .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+      };
+
+      if (vkCreateSemaphore(
+              device,
+              &semaphoreCreateInfo,
+              nullptr,
+              &this->currentBatch.semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload semaphore");
+      }
+    }
+  }
+
+  VkCommandBufferBeginInfo commandBufferBeginInfo = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .pNext = nullptr,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+      .pInheritanceInfo = nullptr,
+  };
+
+  vkBeginCommandBuffer(
+      this->currentBatch.commandBuffer, &commandBufferBeginInfo);
+
+  if (this->transferOwnership) {
+    vkBeginCommandBuffer(
+        this->currentBatch.acquireCommandBuffer, &commandBufferBeginInfo);
+  }
+
+  return this->currentBatch.commandBuffer;
+}
+
+VkCommandPool UploadQueue::createCommandPool(uint32_t queueFamilyIndex) {
+  VkCommandPoolCreateInfo cmdPoolCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+               VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+      .queueFamilyIndex = queueFamilyIndex,
+  };
+
+  VkCommandPool commandPool;
+  if (vkCreateCommandPool(
+          this->framework->getContext()->getDevice(),
+          &cmdPoolCreateInfo,
+          nullptr,
+          &commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create upload command pool");
+  }
+
+  return commandPool;
+}
+
+void UploadQueue::releaseBuffer(
+    VkBuffer buffer,
+    VkDeviceSize offset,
+    VkDeviceSize size,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask) {
+  VkContext *context = this->framework->getContext();
+
+  VkBufferMemoryBarrier bufferMemoryBarrier = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = dstAccessMask,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .buffer = buffer,
+      .offset = offset,
+      .size = size,
+  };
+
+  if (!this->transferOwnership) {
+    vkCmdPipelineBarrier(
+        this->currentBatch.commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        dstStageMask,
+        0,
+        0,
+        nullptr,
+        1,
+        &bufferMemoryBarrier,
+        0,
+        nullptr);
+    return;
+  }
+
+  bufferMemoryBarrier.srcQueueFamilyIndex =
+      context->getTransferQueueFamilyIndex();
+  bufferMemoryBarrier.dstQueueFamilyIndex =
+      context->getGraphicsQueueFamilyIndex();
+
+  // Release on the transfer queue, dstAccessMask is ignored
+  bufferMemoryBarrier.dstAccessMask = 0;
+  vkCmdPipelineBarrier(
+      this->currentBatch.commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      0,
+      0,
+      nullptr,
+      1,
+      &bufferMemoryBarrier,
+      0,
+      nullptr);
+
+  // Acquire on the graphics queue, srcAccessMask is ignored
+  bufferMemoryBarrier.srcAccessMask = 0;
+  bufferMemoryBarrier.dstAccessMask = dstAccessMask;
+  vkCmdPipelineBarrier(
+      this->currentBatch.acquireCommandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      dstStageMask,
+      0,
+      0,
+      nullptr,
+      1,
+      &bufferMemoryBarrier,
+      0,
+      nullptr);
+}
+
+void UploadQueue::releaseImage(
+    VkImage image,
+    const VkImageSubresourceRange &subresourceRange,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask) {
+  VkContext *context = this->framework->getContext();
+
+  VkImageMemoryBarrier imageMemoryBarrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = dstAccessMask,
+      .oldLayout = oldLayout,
+      .newLayout = newLayout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = subresourceRange,
+  };
+
+  if (!this->transferOwnership) {
+    vkCmdPipelineBarrier(
+        this->currentBatch.commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        dstStageMask,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &imageMemoryBarrier);
+    return;
+  }
+
+  // The layout transition is specified identically in both barriers and
+  // only happens once
+  imageMemoryBarrier.srcQueueFamilyIndex =
+      context->getTransferQueueFamilyIndex();
+  imageMemoryBarrier.dstQueueFamilyIndex =
+      context->getGraphicsQueueFamilyIndex();
+
+  imageMemoryBarrier.dstAccessMask = 0;
+  vkCmdPipelineBarrier(
+      this->currentBatch.commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &imageMemoryBarrier);
+
+  imageMemoryBarrier.srcAccessMask = 0;
+  imageMemoryBarrier.dstAccessMask = dstAccessMask;
+  vkCmdPipelineBarrier(
+      this->currentBatch.acquireCommandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      dstStageMask,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &imageMemoryBarrier);
+}
+
+void UploadQueue::collect(bool waitForOldest) {
+  while (!this->submittedBatches.empty()) {
+    Batch &batch = this->submittedBatches.front();
+
+    if (waitForOldest) {
+      this->timeline.wait(batch.ticket);
+      waitForOldest = false;
+    } else if (!this->timeline.isComplete(batch.ticket)) {
+      break;
+    }
+
+    this->framework->getStagingBuffer()->release(batch.stagingEnd);
+    this->completedTicket = batch.ticket;
+
+    vkResetCommandBuffer(batch.commandBuffer, 0);
+    if (batch.acquireCommandBuffer != VK_NULL_HANDLE) {
+      vkResetCommandBuffer(batch.acquireCommandBuffer, 0);
+    }
+
+    this->freeBatches.push_back(batch);
+    this->submittedBatches.pop_front();
+  }
+}
+
+UploadTicket UploadQueue::enqueueBuffer(
+    Buffer &buffer,
+    const void *data,
+    size_t size,
+    VkDeviceSize dstOffset,
+    VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags dstStageMask) {
+  VkDeviceSize offset = this->stage(data, size, STAGING_ALIGNMENT);
+  VkCommandBuffer commandBuffer = this->getCommandBuffer();
+
+  VkBufferCopy bufferCopyInfo = {
+      .srcOffset = offset,
+      .dstOffset = dstOffset,
+      .size = size,
+  };
+
+  vkCmdCopyBuffer(
+      commandBuffer,
+      this->framework->getStagingBuffer()->getHandle(),
+      buffer.getHandle(),
+      1,
+      &bufferCopyInfo);
+
+  // Only the written range changes hands, the rest of the buffer may be in
+  // use by the graphics queue
+  this->releaseBuffer(
+      buffer.getHandle(), dstOffset, size, dstAccessMask, dstStageMask);
+
+  return this->currentBatch.ticket;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "../renderer/timeline_semaphore.hpp"
+#include "../texture/texture.hpp"
+#include "buffer.hpp"
+#include "index_buffer.hpp"
+#include "uniform_buffer.hpp"
+#include "vertex_buffer.hpp"
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+
+// Identifies the batch an upload was recorded in. Tickets increase
+// monotonically, so every ticket lower than a completed one is complete too.
+// A batch signals its ticket on the upload timeline once it's usable.
+typedef uint64_t UploadTicket;
+
+// Records copies from the staging buffer into device local resources and
+// submits them in batches, without waiting for them to finish.
+// If the device has a dedicated transfer queue the copies run there and the
+// resources are then handed over to the graphics queue family.
+class UploadQueue {
+public:
+  UploadQueue(Framework *framework);
+  UploadQueue(const UploadQueue &) = delete;
+  UploadQueue &operator=(const UploadQueue &) = delete;
+  ~UploadQueue();
+
+  // Records a copy of data into a vertex buffer, dstOffset bytes from its
+  // start
+  UploadTicket enqueue(
+      VertexBuffer &buffer,
+      const void *data,
+      size_t size,
+      VkDeviceSize dstOffset = 0);
+
+  // Records a copy of data into an index buffer, dstOffset bytes from its
+  // start
+  UploadTicket enqueue(
+      IndexBuffer &buffer,
+      const void *data,
+      size_t size,
+      VkDeviceSize dstOffset = 0);
+
+  // Records a copy of data into a uniform buffer
+  UploadTicket enqueue(UniformBuffer &buffer, const void *data, size_t size);
+
+  // Records a copy of tightly packed RGBA data into a texture's first mip
+  // level, and generates the rest of its mip chain with blits
+  UploadTicket enqueue(Texture &texture, const void *data, size_t size);
+
+  // Records a copy of every mip level of a texture, e.g. block compressed
+  // data loaded from a file. levels locates each level inside data.
+  UploadTicket enqueue(
+      Texture &texture,
+      const void *data,
+      size_t size,
+      const std::vector<TextureLevel> &levels);
+
+  // Submits every recorded copy as a single batch and checks for finished
+  // batches. Returns the ticket of the submitted batch.
+  UploadTicket flush();
+
+  // Returns true if the batch with the given ticket finished executing.
+  // Reads the upload timeline, so it doesn't wait for the next flush.
+  bool isComplete(UploadTicket ticket);
+
+  // Blocks until the batch with the given ticket finished executing,
+  // submitting it first if needed
+  void wait(UploadTicket ticket);
+
+private:
+  Framework *framework{nullptr};
+
+  // Whether copies run on a different queue family than rendering
+  bool transferOwnership = false;
+
+  VkCommandPool commandPool{VK_NULL_HANDLE};
+  VkCommandPool acquireCommandPool{VK_NULL_HANDLE};
+
+  struct Batch {
+    UploadTicket ticket = 0;
+    // Records the copies, runs on the transfer queue
+    VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+    // Acquires ownership of the uploaded resources, runs on the graphics
+    // queue. Only used when transferring ownership.
+    VkCommandBuffer acquireCommandBuffer{VK_NULL_HANDLE};
+    VkSemaphore semaphore{VK_NULL_HANDLE};
+    // Staging buffer head after the batch's last allocation
+    VkDeviceSize stagingEnd = 0;
+  };
+
+  // Batch currently being recorded, its command buffer is null if nothing
+  // was recorded yet
+  Batch currentBatch;
+  std::deque<Batch> submittedBatches;
+  std::vector<Batch> freeBatches;
+
+  UploadTicket completedTicket = 0;
+
+  // Signaled with the ticket of every batch once the graphics queue can use
+  // its resources
+  TimelineSemaphore timeline;
+
+  // Reserves space in the staging buffer and copies data into it, waiting
+  // for older batches to finish if the staging buffer is full
+  VkDeviceSize stage(const void *data, size_t size, size_t alignment);
+
+  // Returns the command buffer of the current batch, beginning it if needed
+  VkCommandBuffer getCommandBuffer();
+
+  // Creates a command pool for the given queue family
+  VkCommandPool createCommandPool(uint32_t queueFamilyIndex);
+
+  // Records the barriers that make a range of a buffer available to its
+  // consumers, moving the range to the graphics queue family if needed
+  void releaseBuffer(
+      VkBuffer buffer,
+      VkDeviceSize offset,
+      VkDeviceSize size,
+      VkAccessFlags dstAccessMask,
+      VkPipelineStageFlags dstStageMask);
+
+  // Same as releaseBuffer, for an image that also changes layout
+  void releaseImage(
+      VkImage image,
+      const VkImageSubresourceRange &subresourceRange,
+      VkImageLayout oldLayout,
+      VkImageLayout newLayout,
+      VkAccessFlags dstAccessMask,
+      VkPipelineStageFlags dstStageMask);
+
+  // Moves every level of a texture to TRANSFER_DST_OPTIMAL and copies the
+  // given levels into it from the staging buffer
+  void recordTextureCopies(
+      Texture &texture,
+      VkDeviceSize offset,
+      const std::vector<TextureLevel> &levels);
+
+  // Fills every mip level after the first one by blitting from the level
+  // before it, and leaves the whole image ready for sampling. Expects every
+  // level to be in TRANSFER_DST_OPTIMAL.
+  void generateMipmaps(VkCommandBuffer commandBuffer, Texture &texture);
+
+  // Releases the resources of submitted batches that finished executing
+  void collect(bool waitForOldest);
+
+  UploadTicket enqueueBuffer(
+      Buffer &buffer,
+      const void *data,
+      size_t size,
+      VkDeviceSize dstOffset,
+      VkAccessFlags dstAccessMask,
+      VkPipelineStageFlags dstStageMask);
+};
+} // namespace vkf
@@ -10,8 +10,11 @@ VertexBuffer::VertexBuffer(Framework *framework, size_t size)
       .pNext = nullptr,
       .flags = 0,
       .size = size,
-      .usage =
-          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      // Also a transfer source, so the geometry pool can move data out of it
+      // when defragmenting
+      .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+               VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
       .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
       .queueFamilyIndexCount = 0,
       .pQueueFamilyIndices = nullptr,
@@ -32,6 +32,10 @@ glm::mat4 PerspectiveCamera::getProjectionMatrix() {
   return this->projection;
 }
 
+Frustum PerspectiveCamera::getFrustum() {
+  return Frustum(this->getProjectionMatrix() * this->getViewMatrix());
+}
+
 void PerspectiveCamera::update() {
   this->updateDirections();
   this->updateProjection();
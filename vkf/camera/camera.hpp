@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../culling/frustum.hpp"
 #include <glm/glm.hpp>
 
 namespace vkf {
@@ -18,6 +19,10 @@ public:
 
   glm::mat4 getViewMatrix();
   glm::mat4 getProjectionMatrix();
+
+  // Returns the world space planes of the camera's view volume
+  Frustum getFrustum();
+
   void update();
 
   void setPos(glm::vec3 pos);
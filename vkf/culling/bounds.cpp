@@ -0,0 +1,54 @@
+#include "bounds.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace vkf;
+
+BoundingBox
+BoundingBox::fromVertices(const Vertex *vertices, uint32_t vertexCount) {
+  BoundingBox box;
+  if (vertexCount == 0) {
+    return box;
+  }
+
+  box.min = vertices[0].pos;
+  box.max = vertices[0].pos;
+  for (uint32_t i = 1; i < vertexCount; i++) {
+    box.min = glm::min(box.min, vertices[i].pos);
+    box.max = glm::max(box.max, vertices[i].pos);
+  }
+
+  return box;
+}
+
+BoundingSphere
+BoundingSphere::fromVertices(const Vertex *vertices, uint32_t vertexCount) {
+  BoundingBox box = BoundingBox::fromVertices(vertices, vertexCount);
+
+  BoundingSphere sphere;
+  sphere.center = (box.min + box.max) * 0.5f;
+
+  // Compared squared, only the largest distance needs a square root
+  float radiusSquared = 0.0f;
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    glm::vec3 offset = vertices[i].pos - sphere.center;
+    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+  }
+  sphere.radius = std::sqrt(radiusSquared);
+
+  return sphere;
+}
+
+BoundingSphere BoundingSphere::transform(const glm::mat4 &matrix) const {
+  float scaleSquared = std::max(
+      std::max(
+          glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+          glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))),
+      glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2])));
+
+  BoundingSphere sphere;
+  sphere.center = glm::vec3(matrix * glm::vec4(this->center, 1.0f));
+  sphere.radius = this->radius * std::sqrt(scaleSquared);
+
+  return sphere;
+}
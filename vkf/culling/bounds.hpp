@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../mesh/vertex.hpp"
+#include <glm/glm.hpp>
+
+namespace vkf {
+// Axis aligned bounding box
+struct BoundingBox {
+  glm::vec3 min{0.0f};
+  glm::vec3 max{0.0f};
+
+  static BoundingBox fromVertices(const Vertex *vertices, uint32_t vertexCount);
+};
+
+struct BoundingSphere {
+  glm::vec3 center{0.0f};
+  float radius = 0.0f;
+
+  // Returns the sphere centered on the vertices' bounding box that encloses
+  // every vertex
+  static BoundingSphere
+  fromVertices(const Vertex *vertices, uint32_t vertexCount);
+
+  // Returns a sphere enclosing this one once transformed. The radius is
+  // scaled by the matrix's largest axis scale.
+  BoundingSphere transform(const glm::mat4 &matrix) const;
+};
+} // namespace vkf
@@ -0,0 +1,95 @@
+#include "culling_set.hpp"
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+using namespace vkf;
+
+uint32_t CullingSet::add(const BoundingSphere &sphere) {
+  this->centersX.push_back(sphere.center.x);
+  this->centersY.push_back(sphere.center.y);
+  this->centersZ.push_back(sphere.center.z);
+  this->radii.push_back(sphere.radius);
+
+  return static_cast<uint32_t>(this->radii.size() - 1);
+}
+
+void CullingSet::set(uint32_t index, const BoundingSphere &sphere) {
+  this->centersX[index] = sphere.center.x;
+  this->centersY[index] = sphere.center.y;
+  this->centersZ[index] = sphere.center.z;
+  this->radii[index] = sphere.radius;
+}
+
+void CullingSet::resize(size_t size) {
+  this->centersX.resize(size, 0.0f);
+  this->centersY.resize(size, 0.0f);
+  this->centersZ.resize(size, 0.0f);
+  this->radii.resize(size, 0.0f);
+}
+
+void CullingSet::clear() {
+  this->centersX.clear();
+  this->centersY.clear();
+  this->centersZ.clear();
+  this->radii.clear();
+}
+
+size_t CullingSet::size() const {
+  return this->radii.size();
+}
+
+void CullingSet::cull(
+    const Frustum &frustum, std::vector<uint32_t> &visible) const {
+  visible.clear();
+
+  const std::array<glm::vec4, 6> &planes = frustum.getPlanes();
+  const size_t count = this->radii.size();
+  size_t i = 0;
+
+  // A sphere is visible if it isn't entirely behind any of the planes, i.e.
+  // dot(normal, center) + distance + radius >= 0 for all six
+
+#ifdef __SSE2__
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(&this->centersX[i]);
+    __m128 y = _mm_loadu_ps(&this->centersY[i]);
+    __m128 z = _mm_loadu_ps(&this->centersZ[i]);
+    __m128 radius = _mm_loadu_ps(&this->radii[i]);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (const auto &plane : planes) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(
+              _mm_mul_ps(x, _mm_set1_ps(plane.x)),
+              _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+          _mm_add_ps(
+              _mm_mul_ps(z, _mm_set1_ps(plane.z)),
+              _mm_add_ps(radius, _mm_set1_ps(plane.w))));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+    }
+
+    for (int mask = _mm_movemask_ps(inside); mask != 0; mask &= mask - 1) {
+      visible.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask)));
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    bool inside = true;
+    for (const auto &plane : planes) {
+      float distance = this->centersX[i] * plane.x +
+                       this->centersY[i] * plane.y +
+                       this->centersZ[i] * plane.z + this->radii[i] + plane.w;
+      if (distance < 0.0f) {
+        inside = false;
+        break;
+      }
+    }
+
+    if (inside) {
+      visible.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "frustum.hpp"
+#include <vector>
+
+namespace vkf {
+// Bounding spheres stored as separate arrays of center coordinates and
+// radii, so they can be tested against a frustum four at a time with SSE
+class CullingSet {
+public:
+  // Adds a sphere and returns its index
+  uint32_t add(const BoundingSphere &sphere);
+
+  // Replaces the sphere at index, e.g. after its object moved
+  void set(uint32_t index, const BoundingSphere &sphere);
+
+  // Resizes the set, new spheres are empty and at the origin
+  void resize(size_t size);
+  void clear();
+  size_t size() const;
+
+  // Replaces visible with the indices of the spheres intersecting the
+  // frustum, in increasing order
+  void cull(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+private:
+  std::vector<float> centersX;
+  std::vector<float> centersY;
+  std::vector<float> centersZ;
+  std::vector<float> radii;
+};
+} // namespace vkf
@@ -0,0 +1,57 @@
+#include "frustum.hpp"
+
+using namespace vkf;
+
+Frustum::Frustum(const glm::mat4 &viewProjection) {
+  // Rows of the matrix, glm matrices are indexed by column first
+  std::array<glm::vec4, 4> rows;
+  for (int i = 0; i < 4; i++) {
+    rows[i] = glm::vec4(
+        viewProjection[0][i],
+        viewProjection[1][i],
+        viewProjection[2][i],
+        viewProjection[3][i]);
+  }
+
+  // A clip space point is inside if -w <= x, y, z <= w
+  this->planes[0] = rows[3] + rows[0];
+  this->planes[1] = rows[3] - rows[0];
+  this->planes[2] = rows[3] + rows[1];
+  this->planes[3] = rows[3] - rows[1];
+  this->planes[4] = rows[3] + rows[2];
+  this->planes[5] = rows[3] - rows[2];
+
+  for (auto &plane : this->planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const {
+  for (const auto &plane : this->planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Frustum::intersects(const BoundingBox &box) const {
+  for (const auto &plane : this->planes) {
+    // The corner furthest along the plane's normal
+    glm::vec3 corner(
+        plane.x >= 0.0f ? box.max.x : box.min.x,
+        plane.y >= 0.0f ? box.max.y : box.min.y,
+        plane.z >= 0.0f ? box.max.z : box.min.z);
+
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const std::array<glm::vec4, 6> &Frustum::getPlanes() const {
+  return this->planes;
+}
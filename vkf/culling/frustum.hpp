@@ -0,0 +1,27 @@
+#pragma once
+
+#include "bounds.hpp"
+#include <array>
+#include <glm/glm.hpp>
+
+namespace vkf {
+// The six planes of a camera's view volume, in world space
+class Frustum {
+public:
+  Frustum(){};
+
+  // Extracts the planes from a projection * view matrix
+  Frustum(const glm::mat4 &viewProjection);
+
+  bool intersects(const BoundingSphere &sphere) const;
+  bool intersects(const BoundingBox &box) const;
+
+  // Planes as (normal, distance), normalized, with the normals pointing
+  // inside. A point p is inside a plane if dot(normal, p) + distance >= 0.
+  // Ordered left, right, bottom, top, near, far.
+  const std::array<glm::vec4, 6> &getPlanes() const;
+
+private:
+  std::array<glm::vec4, 6> planes;
+};
+} // namespace vkf
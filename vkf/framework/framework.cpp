@@ -6,7 +6,15 @@ Framework::Framework(const char *title, int width, int height)
     : window(title, width, height), context(&window) {
 }
 
+Framework::Framework(int width, int height)
+    : window(width, height), context(&window) {
+}
+
 Framework::~Framework() {
+  this->geometryPool.destroy();
+  this->textureTable.destroy();
+  this->instanceRing.destroy();
+  this->uniformRing.destroy();
   this->stagingBuffer.destroy();
 }
 
@@ -21,3 +29,56 @@ VkContext *Framework::getContext() {
 StagingBuffer *Framework::getStagingBuffer() {
   return &this->stagingBuffer;
 }
+
+RingBuffer *Framework::getUniformRing() {
+  return &this->uniformRing;
+}
+
+RingBuffer *Framework::getInstanceRing() {
+  return &this->instanceRing;
+}
+
+UploadQueue *Framework::getUploadQueue() {
+  return &this->uploadQueue;
+}
+
+TextureLoader *Framework::getTextureLoader() {
+  return &this->textureLoader;
+}
+
+TextureTable *Framework::getTextureTable() {
+  return &this->textureTable;
+}
+
+GeometryPool *Framework::getGeometryPool() {
+  return &this->geometryPool;
+}
+
+void Framework::setCamera(
+    const glm::mat4 &view, const glm::mat4 &projection) {
+  std::lock_guard<std::mutex> lock(this->cameraMutex);
+
+  this->camera = {view, projection};
+  this->cameraOffset =
+      this->uniformRing.allocate(&this->camera, sizeof(this->camera));
+  this->cameraFrameNumber = this->context.getFrameNumber();
+}
+
+uint32_t Framework::getCameraOffset() {
+  std::lock_guard<std::mutex> lock(this->cameraMutex);
+
+  if (this->cameraFrameNumber != this->context.getFrameNumber()) {
+    this->cameraOffset =
+        this->uniformRing.allocate(&this->camera, sizeof(this->camera));
+    this->cameraFrameNumber = this->context.getFrameNumber();
+  }
+
+  return this->cameraOffset;
+}
+
+void Framework::update() {
+  this->textureLoader.update();
+  this->geometryPool.update();
+  this->textureTable.update();
+  this->uploadQueue.flush();
+}
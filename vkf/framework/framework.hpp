@@ -1,24 +1,81 @@
 #pragma once
 
+#include "../buffer/geometry_pool.hpp"
+#include "../buffer/ring_buffer.hpp"
 #include "../buffer/staging_buffer.hpp"
+#include "../buffer/upload_queue.hpp"
 #include "../renderer/vk_context.hpp"
+#include "../texture/texture_loader.hpp"
+#include "../texture/texture_table.hpp"
 #include "../window/window.hpp"
+#include <glm/glm.hpp>
+#include <mutex>
 
 namespace vkf {
 const size_t STAGING_BUFFER_SIZE = 1000 * 1000 * 100; // 100 MB
+const size_t UNIFORM_RING_SIZE = 1000 * 1000 * 4;     // 4 MB per frame
+const size_t INSTANCE_RING_SIZE = 1000 * 1000 * 8;    // 8 MB per frame
+const uint32_t GEOMETRY_POOL_VERTEX_COUNT = 1024 * 1024;    // 32 MB
+const uint32_t GEOMETRY_POOL_INDEX_COUNT = 4 * 1024 * 1024; // 16 MB
+
+// Camera matrices shared by every mesh drawn in a frame, read from binding 1
+// of standard materials
+struct CameraUniform {
+  glm::mat4 view;
+  glm::mat4 proj;
+};
 
 class Framework {
 public:
   Framework(const char *title, int width, int height);
+
+  // Creates a framework without a window, rendering into offscreen images
+  Framework(int width, int height);
   ~Framework();
 
   Window *getWindow();
   VkContext *getContext();
   StagingBuffer *getStagingBuffer();
+  RingBuffer *getUniformRing();
+  // Per frame InstanceData of instanced draws
+  RingBuffer *getInstanceRing();
+  UploadQueue *getUploadQueue();
+  TextureLoader *getTextureLoader();
+  // Disabled if the device doesn't support descriptor indexing
+  TextureTable *getTextureTable();
+  GeometryPool *getGeometryPool();
+
+  // Copies the camera's matrices into this frame's region of the uniform
+  // ring, once for every mesh drawn after it
+  void setCamera(const glm::mat4 &view, const glm::mat4 &projection);
+
+  // Returns the offset of this frame's camera matrices in the uniform ring,
+  // re-sending the last ones if the camera wasn't set this frame
+  uint32_t getCameraOffset();
+
+  // Uploads textures that finished decoding, submits pending uploads,
+  // checks for finished ones and reclaims freed geometry and texture table
+  // slots, should be called once per frame
+  void update();
 
 protected:
   Window window;
   VkContext context;
   StagingBuffer stagingBuffer{this, STAGING_BUFFER_SIZE};
+  RingBuffer uniformRing{
+      this, UNIFORM_RING_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT};
+  RingBuffer instanceRing{
+      this, INSTANCE_RING_SIZE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT};
+  UploadQueue uploadQueue{this};
+  TextureTable textureTable{this};
+  TextureLoader textureLoader{this};
+  GeometryPool geometryPool{
+      this, GEOMETRY_POOL_VERTEX_COUNT, GEOMETRY_POOL_INDEX_COUNT};
+
+  CameraUniform camera{glm::mat4(1.0f), glm::mat4(1.0f)};
+  uint32_t cameraOffset = 0;
+  uint64_t cameraFrameNumber = UINT64_MAX;
+  // Meshes may ask for the offset while drawing in parallel
+  std::mutex cameraMutex;
 };
 } // namespace vkf
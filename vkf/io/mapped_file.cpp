@@ -0,0 +1,52 @@
+#include "mapped_file.hpp"
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace vkf;
+
+MappedFile::MappedFile(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to open \"" + std::string(path) + "\"");
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) == -1) {
+    close(fd);
+    throw std::runtime_error(
+        "Failed to get the size of \"" + std::string(path) + "\"");
+  }
+
+  this->size = static_cast<size_t>(fileStat.st_size);
+
+  // mmap doesn't accept empty mappings
+  if (this->size > 0) {
+    this->data = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+
+  if (this->data == MAP_FAILED) {
+    this->data = nullptr;
+    throw std::runtime_error("Failed to map \"" + std::string(path) + "\"");
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (this->data != nullptr) {
+    munmap(this->data, this->size);
+  }
+}
+
+const unsigned char *MappedFile::getData() const {
+  return static_cast<const unsigned char *>(this->data);
+}
+
+size_t MappedFile::getSize() const {
+  return this->size;
+}
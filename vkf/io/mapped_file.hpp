@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace vkf {
+// Read only memory mapping of a whole file. The pages are loaded by the OS on
+// first access, so reading a range never copies more than that range.
+class MappedFile {
+public:
+  MappedFile(const char *path);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  const unsigned char *getData() const;
+  size_t getSize() const;
+
+private:
+  void *data{nullptr};
+  size_t size = 0;
+};
+} // namespace vkf
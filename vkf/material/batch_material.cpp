@@ -0,0 +1,18 @@
+#include "batch_material.hpp"
+#include "../framework/framework.hpp"
+
+using namespace vkf;
+
+BatchMaterial::BatchMaterial(Framework *framework)
+    : StandardMaterial(
+          framework,
+          framework->getTextureTable()->isEnabled()
+              ? "shaders/batch_bindless.vert.spv"
+              : "shaders/batch.vert.spv",
+          framework->getTextureTable()->isEnabled()
+              ? "shaders/batch_bindless.frag.spv"
+              : "shaders/shader.frag.spv",
+          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+          framework->getTextureTable()->isEnabled() ? INSTANCE_INPUT_BATCH
+                                                    : INSTANCE_INPUT_NONE) {
+}
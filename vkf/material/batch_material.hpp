@@ -0,0 +1,14 @@
+#pragma once
+
+#include "standard_material.hpp"
+
+namespace vkf {
+// Standard material whose per draw data lives in a storage buffer, indexed by
+// the draw's instance index. Drawn through a BatchRenderer. With the texture
+// table enabled, every draw's texture index is read from vertex binding 1.
+class BatchMaterial : public StandardMaterial {
+public:
+  BatchMaterial(Framework *framework);
+  virtual ~BatchMaterial(){};
+};
+} // namespace vkf
@@ -0,0 +1,210 @@
+#include "compute_pipeline.hpp"
+#include "../framework/framework.hpp"
+#include <map>
+#include <stdexcept>
+
+using namespace vkf;
+
+ComputePipeline::ComputePipeline(
+    Framework *framework,
+    const char *shaderPath,
+    const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+    uint32_t pushConstantSize,
+    uint32_t maxDescriptorSets)
+    : framework(framework) {
+  VkDevice device = this->framework->getContext()->getDevice();
+
+  this->shaderModule =
+      this->framework->getContext()->loadShaderModule(shaderPath);
+
+  VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .bindingCount = static_cast<uint32_t>(bindings.size()),
+      .pBindings = bindings.data(),
+  };
+
+  if (vkCreateDescriptorSetLayout(
+          device,
+          &descriptorSetLayoutCreateInfo,
+          nullptr,
+          &this->descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create compute descriptor set layout");
+  }
+
+  VkPushConstantRange pushConstantRange = {
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      .offset = 0,
+      .size = pushConstantSize,
+  };
+
+  VkPipelineLayoutCreateInfo layoutCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .setLayoutCount = 1,
+      .pSetLayouts = &this->descriptorSetLayout,
+      .pushConstantRangeCount = pushConstantSize > 0 ? 1u : 0u,
+      .pPushConstantRanges = &pushConstantRange,
+  };
+
+  if (vkCreatePipelineLayout(
+          device, &layoutCreateInfo, nullptr, &this->pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create compute pipeline layout");
+  }
+
+  VkComputePipelineCreateInfo pipelineCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .stage =
+          {
+              .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+              .pNext = nullptr,
+              .flags = 0,
+              .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+              .module = this->shaderModule,
+              .pName = "main",
+              .pSpecializationInfo = nullptr,
+          },
+      .layout = this->pipelineLayout,
+      .basePipelineHandle = VK_NULL_HANDLE,
+      .basePipelineIndex = -1,
+  };
+
+  if (vkCreateComputePipelines(
+          device,
+          this->framework->getContext()->getPipelineCache(),
+          1,
+          &pipelineCreateInfo,
+          nullptr,
+          &this->pipeline) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create compute pipeline");
+  }
+
+  // Enough descriptors of every type used by the bindings for every set
+  std::map<VkDescriptorType, uint32_t> descriptorCounts;
+  for (const auto &binding : bindings) {
+    descriptorCounts[binding.descriptorType] +=
+        binding.descriptorCount * maxDescriptorSets;
+  }
+
+  std::vector<VkDescriptorPoolSize> poolSizes;
+  for (const auto &descriptorCount : descriptorCounts) {
+    poolSizes.push_back({
+        .type = descriptorCount.first,
+        .descriptorCount = descriptorCount.second,
+    });
+  }
+
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .maxSets = maxDescriptorSets,
+      .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+      .pPoolSizes = poolSizes.data(),
+  };
+
+  if (vkCreateDescriptorPool(
+          device,
+          &descriptorPoolCreateInfo,
+          nullptr,
+          &this->descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create compute descriptor pool");
+  }
+}
+
+ComputePipeline::~ComputePipeline() {
+  VkDevice device = this->framework->getContext()->getDevice();
+  if (device == VK_NULL_HANDLE) {
+    return;
+  }
+
+  vkDeviceWaitIdle(device);
+
+  if (this->descriptorPool != VK_NULL_HANDLE) {
+    vkDestroyDescriptorPool(device, this->descriptorPool, nullptr);
+  }
+
+  if (this->pipeline != VK_NULL_HANDLE) {
+    vkDestroyPipeline(device, this->pipeline, nullptr);
+  }
+
+  if (this->pipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(device, this->pipelineLayout, nullptr);
+  }
+
+  if (this->descriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(device, this->descriptorSetLayout, nullptr);
+  }
+
+  if (this->shaderModule != VK_NULL_HANDLE) {
+    vkDestroyShaderModule(device, this->shaderModule, nullptr);
+  }
+}
+
+VkDescriptorSet ComputePipeline::allocateDescriptorSet() {
+  VkDescriptorSetAllocateInfo allocateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .descriptorPool = this->descriptorPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &this->descriptorSetLayout,
+  };
+
+  VkDescriptorSet descriptorSet;
+  if (vkAllocateDescriptorSets(
+          this->framework->getContext()->getDevice(),
+          &allocateInfo,
+          &descriptorSet) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate compute descriptor set");
+  }
+
+  return descriptorSet;
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(
+      commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->pipeline);
+}
+
+void ComputePipeline::bindDescriptorSet(
+    VkCommandBuffer commandBuffer,
+    VkDescriptorSet descriptorSet,
+    const std::vector<uint32_t> &dynamicOffsets) {
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_COMPUTE,
+      this->pipelineLayout,
+      0,
+      1,
+      &descriptorSet,
+      static_cast<uint32_t>(dynamicOffsets.size()),
+      dynamicOffsets.data());
+}
+
+void ComputePipeline::pushConstants(
+    VkCommandBuffer commandBuffer, const void *data, uint32_t size) {
+  vkCmdPushConstants(
+      commandBuffer,
+      this->pipelineLayout,
+      VK_SHADER_STAGE_COMPUTE_BIT,
+      0,
+      size,
+      data);
+}
+
+void ComputePipeline::dispatch(
+    VkCommandBuffer commandBuffer,
+    uint32_t invocationCount,
+    uint32_t groupSize) {
+  vkCmdDispatch(
+      commandBuffer, (invocationCount + groupSize - 1) / groupSize, 1, 1);
+}
+
+VkPipelineLayout ComputePipeline::getPipelineLayout() {
+  return this->pipelineLayout;
+}
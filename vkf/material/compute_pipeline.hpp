@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+
+// Compute shader with a single descriptor set layout and an optional push
+// constant range. Descriptor sets are allocated from the pipeline's own
+// pool, sized for maxDescriptorSets sets.
+class ComputePipeline {
+public:
+  ComputePipeline(
+      Framework *framework,
+      const char *shaderPath,
+      const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+      uint32_t pushConstantSize,
+      uint32_t maxDescriptorSets);
+  ComputePipeline(const ComputePipeline &) = delete;
+  ComputePipeline &operator=(const ComputePipeline &) = delete;
+  ~ComputePipeline();
+
+  VkDescriptorSet allocateDescriptorSet();
+
+  void bind(VkCommandBuffer commandBuffer);
+
+  void bindDescriptorSet(
+      VkCommandBuffer commandBuffer,
+      VkDescriptorSet descriptorSet,
+      const std::vector<uint32_t> &dynamicOffsets);
+
+  void
+  pushConstants(VkCommandBuffer commandBuffer, const void *data, uint32_t size);
+
+  // Dispatches enough work groups of groupSize invocations to cover
+  // invocationCount invocations along x
+  void dispatch(
+      VkCommandBuffer commandBuffer,
+      uint32_t invocationCount,
+      uint32_t groupSize);
+
+  VkPipelineLayout getPipelineLayout();
+
+private:
+  Framework *framework;
+
+  VkShaderModule shaderModule{VK_NULL_HANDLE};
+  VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+  VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+  VkPipeline pipeline{VK_NULL_HANDLE};
+  VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+};
+} // namespace vkf
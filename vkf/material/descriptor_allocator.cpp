@@ -0,0 +1,185 @@
+#include "descriptor_allocator.hpp"
+#include "../framework/framework.hpp"
+#include <stdexcept>
+
+using namespace vkf;
+
+DescriptorAllocator::DescriptorAllocator(
+    Framework *framework,
+    VkDescriptorSetLayout descriptorSetLayout,
+    const std::vector<VkDescriptorPoolSize> &poolSizes)
+    : framework(framework),
+      descriptorSetLayout(descriptorSetLayout),
+      transientPools(MAX_FRAMES_IN_FLIGHT) {
+  for (const auto &poolSize : poolSizes) {
+    this->poolSizes.push_back({
+        .type = poolSize.type,
+        .descriptorCount = poolSize.descriptorCount * DESCRIPTOR_POOL_SET_COUNT,
+    });
+  }
+}
+
+void DescriptorAllocator::destroy() {
+  VkDevice device = this->framework->getContext()->getDevice();
+  if (device == VK_NULL_HANDLE) {
+    return;
+  }
+
+  vkDeviceWaitIdle(device);
+
+  for (VkDescriptorPool pool : this->pools) {
+    vkDestroyDescriptorPool(device, pool, nullptr);
+  }
+  this->pools.clear();
+  this->freeSets.clear();
+  this->pendingFrees.clear();
+
+  for (auto &frame : this->transientPools) {
+    for (VkDescriptorPool pool : frame.pools) {
+      vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    frame.pools.clear();
+    frame.current = 0;
+    frame.allocated = 0;
+  }
+}
+
+VkDescriptorSet DescriptorAllocator::allocate() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  VkContext *context = this->framework->getContext();
+
+  // Sets are freed in frame order, so the ones the GPU is done with are at
+  // the front
+  auto it = this->pendingFrees.begin();
+  while (it != this->pendingFrees.end() &&
+         context->isFrameComplete(it->frameNumber)) {
+    this->freeSets.push_back(it->descriptorSet);
+    ++it;
+  }
+  this->pendingFrees.erase(this->pendingFrees.begin(), it);
+
+  if (this->freeSets.empty()) {
+    this->grow();
+  }
+
+  VkDescriptorSet descriptorSet = this->freeSets.back();
+  this->freeSets.pop_back();
+  return descriptorSet;
+}
+
+void DescriptorAllocator::free(VkDescriptorSet descriptorSet) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->pendingFrees.push_back({
+      .descriptorSet = descriptorSet,
+      .frameNumber = this->framework->getContext()->getFrameNumber(),
+  });
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  VkContext *context = this->framework->getContext();
+  TransientPools &frame = this->transientPools[context->getCurrentFrame()];
+
+  if (frame.frameNumber != context->getFrameNumber()) {
+    // The sets were last used by this frame in flight's previous frame
+    context->waitForCurrentFrame();
+
+    for (VkDescriptorPool pool : frame.pools) {
+      vkResetDescriptorPool(context->getDevice(), pool, 0);
+    }
+
+    frame.current = 0;
+    frame.allocated = 0;
+    frame.frameNumber = context->getFrameNumber();
+  }
+
+  // Pools are only ever allocated from in whole sets of the same layout, so
+  // counting the sets tells when one is full without relying on
+  // VK_ERROR_OUT_OF_POOL_MEMORY
+  if (frame.allocated == DESCRIPTOR_POOL_SET_COUNT) {
+    frame.current++;
+    frame.allocated = 0;
+  }
+
+  if (frame.current == frame.pools.size()) {
+    frame.pools.push_back(this->createPool());
+  }
+
+  VkDescriptorSetAllocateInfo allocateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .descriptorPool = frame.pools[frame.current],
+      .descriptorSetCount = 1,
+      .pSetLayouts = &this->descriptorSetLayout,
+  };
+
+  VkDescriptorSet descriptorSet;
+  if (vkAllocateDescriptorSets(
+          context->getDevice(), &allocateInfo, &descriptorSet) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate transient descriptor set");
+  }
+
+  frame.allocated++;
+  return descriptorSet;
+}
+
+uint32_t DescriptorAllocator::getPoolCount() const {
+  size_t count = this->pools.size();
+  for (const auto &frame : this->transientPools) {
+    count += frame.pools.size();
+  }
+
+  return static_cast<uint32_t>(count);
+}
+
+VkDescriptorPool DescriptorAllocator::createPool() {
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .maxSets = DESCRIPTOR_POOL_SET_COUNT,
+      .poolSizeCount = static_cast<uint32_t>(this->poolSizes.size()),
+      .pPoolSizes = this->poolSizes.data(),
+  };
+
+  VkDescriptorPool pool;
+  if (vkCreateDescriptorPool(
+          this->framework->getContext()->getDevice(),
+          &descriptorPoolCreateInfo,
+          nullptr,
+          &pool) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create descriptor pool");
+  }
+
+  return pool;
+}
+
+void DescriptorAllocator::grow() {
+  VkDescriptorPool pool = this->createPool();
+  this->pools.push_back(pool);
+
+  std::vector<VkDescriptorSetLayout> setLayouts(
+      DESCRIPTOR_POOL_SET_COUNT, this->descriptorSetLayout);
+
+  VkDescriptorSetAllocateInfo allocateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .descriptorPool = pool,
+      .descriptorSetCount = DESCRIPTOR_POOL_SET_COUNT,
+      .pSetLayouts = setLayouts.data(),
+  };
+
+  size_t first = this->freeSets.size();
+  this->freeSets.resize(first + DESCRIPTOR_POOL_SET_COUNT);
+
+  if (vkAllocateDescriptorSets(
+          this->framework->getContext()->getDevice(),
+          &allocateInfo,
+          &this->freeSets[first]) != VK_SUCCESS) {
+    this->freeSets.resize(first);
+    throw std::runtime_error("Failed to allocate descriptor sets");
+  }
+}
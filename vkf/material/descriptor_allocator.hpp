@@ -0,0 +1,86 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+
+// Number of sets every pool of a descriptor allocator is created with
+const uint32_t DESCRIPTOR_POOL_SET_COUNT = 256;
+
+// Hands out descriptor sets of a single layout. Sets are allocated a pool at
+// a time and kept on a free list, so allocating and freeing them is O(1),
+// and a new pool is created whenever the list runs out. Every pool holds
+// enough descriptors of each type for all of its sets.
+//
+// Transient sets are only valid for the frame they were allocated in. They
+// come from separate pools per frame in flight, which are reset at once the
+// next time that frame allocates.
+class DescriptorAllocator {
+public:
+  // poolSizes are the descriptors of every type a single set needs
+  DescriptorAllocator(
+      Framework *framework,
+      VkDescriptorSetLayout descriptorSetLayout,
+      const std::vector<VkDescriptorPoolSize> &poolSizes);
+  DescriptorAllocator(const DescriptorAllocator &) = delete;
+  DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+  ~DescriptorAllocator(){};
+
+  void destroy();
+
+  // Returns a set that stays allocated until it's freed. Its contents are
+  // whatever was written to it last, if it was used before.
+  VkDescriptorSet allocate();
+
+  // Puts a set back on the free list once the frames in flight are done
+  // with it
+  void free(VkDescriptorSet descriptorSet);
+
+  // Returns a set that is only valid until the current frame in flight comes
+  // around again
+  VkDescriptorSet allocateTransient();
+
+  // Returns the number of pools created so far, persistent and transient
+  uint32_t getPoolCount() const;
+
+private:
+  Framework *framework{nullptr};
+
+  VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+  // Sizes of a whole pool, DESCRIPTOR_POOL_SET_COUNT times the sizes of a set
+  std::vector<VkDescriptorPoolSize> poolSizes;
+
+  std::vector<VkDescriptorPool> pools;
+  std::vector<VkDescriptorSet> freeSets;
+
+  struct PendingFree {
+    VkDescriptorSet descriptorSet;
+    uint64_t frameNumber;
+  };
+
+  // Sets freed while frames in flight could still use them
+  std::vector<PendingFree> pendingFrees;
+
+  struct TransientPools {
+    std::vector<VkDescriptorPool> pools;
+    // Pool currently allocated from, and how many of its sets were taken
+    uint32_t current = 0;
+    uint32_t allocated = 0;
+    // Frame the pools were last reset for
+    uint64_t frameNumber = UINT64_MAX;
+  };
+
+  std::vector<TransientPools> transientPools;
+
+  // Meshes may allocate sets while drawing in parallel
+  std::mutex mutex;
+
+  VkDescriptorPool createPool();
+
+  // Creates a pool and puts all of its sets on the free list
+  void grow();
+};
+} // namespace vkf
@@ -0,0 +1,15 @@
+#include "instanced_material.hpp"
+#include "../framework/framework.hpp"
+
+using namespace vkf;
+
+InstancedMaterial::InstancedMaterial(Framework *framework)
+    : StandardMaterial(
+          framework,
+          "shaders/instanced.vert.spv",
+          framework->getTextureTable()->isEnabled()
+              ? "shaders/bindless.frag.spv"
+              : "shaders/shader.frag.spv",
+          VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+          INSTANCE_INPUT_DATA) {
+}
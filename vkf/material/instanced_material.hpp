@@ -0,0 +1,15 @@
+#pragma once
+
+#include "standard_material.hpp"
+
+namespace vkf {
+// Standard material that reads an InstanceData per instance from vertex
+// binding 1. Every instance's transform is applied before the mesh's model
+// matrix and its tint multiplies the vertex color. Drawn with
+// Mesh::drawInstanced.
+class InstancedMaterial : public StandardMaterial {
+public:
+  InstancedMaterial(Framework *framework);
+  virtual ~InstancedMaterial(){};
+};
+} // namespace vkf
@@ -16,29 +16,44 @@ Material::Material(
 void Material::bindPipeline(VkCommandBuffer commandBuffer) {
   vkCmdBindPipeline(
       commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline);
-}
 
-int Material::getAvailableDescriptorSet() {
-  for (size_t i = 0; i < this->descriptorSetAvailable.size(); ++i) {
-    if (this->descriptorSetAvailable[i]) {
-      return i;
-    }
+  // Stays bound while the draws rebind set 0
+  if (this->bindless) {
+    VkDescriptorSet textureSet =
+        this->framework->getTextureTable()->getDescriptorSet();
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        this->pipelineLayout,
+        1,
+        1,
+        &textureSet,
+        0,
+        nullptr);
   }
-  return -1;
+}
+
+VkPipeline Material::getPipeline() {
+  return this->pipeline;
+}
+
+uint32_t Material::getPipelineRebuildCount() const {
+  return this->pipelineRebuildCount;
+}
+
+DescriptorAllocator *Material::getDescriptorAllocator() {
+  return this->descriptorAllocator.get();
 }
 
 void Material::onResize(uint32_t width, uint32_t height) {
+  if (this->renderPassVersion ==
+      this->framework->getContext()->getRenderPassVersion()) {
+    return;
+  }
+
   if (this->framework->getContext()->getDevice() != VK_NULL_HANDLE) {
     vkDeviceWaitIdle(this->framework->getContext()->getDevice());
 
-    if (this->pipelineLayout != VK_NULL_HANDLE) {
-      vkDestroyPipelineLayout(
-          this->framework->getContext()->getDevice(),
-          this->pipelineLayout,
-          nullptr);
-      this->pipelineLayout = VK_NULL_HANDLE;
-    }
-
     if (this->pipeline != VK_NULL_HANDLE) {
       vkDestroyPipeline(
           this->framework->getContext()->getDevice(), this->pipeline, nullptr);
@@ -46,6 +61,6 @@ void Material::onResize(uint32_t width, uint32_t height) {
     }
   }
 
-  this->createPipelineLayout();
   this->createPipeline();
+  this->pipelineRebuildCount++;
 }
@@ -3,15 +3,17 @@
 #include "../mesh/vertex.hpp"
 #include "../window/window.hpp"
 #include "../window/event_handler.hpp"
-#include <array>
+#include "descriptor_allocator.hpp"
+#include <memory>
+#include <mutex>
 
 namespace vkf {
-const uint32_t MAX_DESCRIPTOR_SETS = 4096;
-
 class Framework;
 
 class Material : public EventHandler {
   friend class Mesh;
+  friend class BatchRenderer;
+  friend class RenderQueue;
 
 public:
   Material(
@@ -23,11 +25,17 @@ public:
 
   void bindPipeline(VkCommandBuffer commandBuffer);
 
+  // Rebuilds the pipeline if the context's render pass was recreated.
+  // Viewport and scissor are dynamic state, so a plain resize keeps it.
   void onResize(uint32_t width, uint32_t height) override;
 
-  // Returns the index of the first available descriptor set
-  // Returns -1 if not found
-  int getAvailableDescriptorSet();
+  VkPipeline getPipeline();
+
+  // Returns how many times onResize rebuilt the pipeline
+  uint32_t getPipelineRebuildCount() const;
+
+  // Allocates the material's descriptor sets, e.g. one per mesh
+  DescriptorAllocator *getDescriptorAllocator();
 
 protected:
   Framework *framework;
@@ -37,16 +45,26 @@ protected:
 
   VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
   VkPipeline pipeline{VK_NULL_HANDLE};
+  // Version of the render pass the pipeline was created against
+  uint32_t renderPassVersion = 0;
+  uint32_t pipelineRebuildCount = 0;
+
+  // Whether textures are read from the framework's texture table, bound as
+  // set 1, instead of from binding 0 of the material's sets
+  bool bindless = false;
 
   VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
-  VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
-  std::array<VkDescriptorSet, MAX_DESCRIPTOR_SETS> descriptorSets;
-  std::array<bool, MAX_DESCRIPTOR_SETS> descriptorSetAvailable;
+  std::unique_ptr<DescriptorAllocator> descriptorAllocator;
+
+  // Set pointing at the texture loader's placeholder, allocated on first
+  // use. Bindless materials share it between every mesh.
+  VkDescriptorSet placeholderDescriptorSet{VK_NULL_HANDLE};
+  // Guards placeholderDescriptorSet, meshes may draw in parallel
+  std::mutex placeholderMutex;
 
   virtual VkPipelineLayout createPipelineLayout() = 0;
   virtual void createPipeline() = 0;
   virtual void createDescriptorSetLayout() = 0;
-  virtual void createDescriptorPool() = 0;
-  virtual void allocateDescriptorSets() = 0;
+  virtual void createDescriptorAllocator() = 0;
 };
 } // namespace vkf
@@ -1,43 +1,37 @@
 #include "standard_material.hpp"
 #include "../framework/framework.hpp"
-#include <fstream>
 
 using namespace vkf;
 
-std::vector<char> loadShaderCode(const char *filename) {
-  std::ifstream file(filename);
-
-  if (file.fail()) {
-    throw std::runtime_error(
-        "Failed to open \"" + std::string(filename) + "\"");
-  }
-
-  std::streampos begin, end;
-  begin = file.tellg();
-  file.seekg(0, std::ios::end);
-  end = file.tellg();
-
-  std::vector<char> result(static_cast<size_t>(end - begin));
-  file.seekg(0, std::ios::beg);
-  file.read(result.data(), end - begin);
-  file.close();
-
-  return result;
+StandardMaterial::StandardMaterial(Framework *framework)
+    : StandardMaterial(
+          framework,
+          "shaders/shader.vert.spv",
+          framework->getTextureTable()->isEnabled()
+              ? "shaders/bindless.frag.spv"
+              : "shaders/shader.frag.spv",
+          VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
 }
 
-StandardMaterial::StandardMaterial(Framework *framework)
+StandardMaterial::StandardMaterial(
+    Framework *framework,
+    const char *vertexShaderPath,
+    const char *fragmentShaderPath,
+    VkDescriptorType bufferDescriptorType,
+    InstanceInput instanceInput)
     : Material(
           framework,
-          framework->getContext()->createShaderModule(
-              loadShaderCode("shaders/shader.vert.spv")),
-          framework->getContext()->createShaderModule(
-              loadShaderCode("shaders/shader.frag.spv"))) {
+          framework->getContext()->loadShaderModule(vertexShaderPath),
+          framework->getContext()->loadShaderModule(fragmentShaderPath)),
+      bufferDescriptorType(bufferDescriptorType),
+      instanceInput(instanceInput) {
+  this->bindless = framework->getTextureTable()->isEnabled();
+
   this->createDescriptorSetLayout();
 
   this->createPipeline();
 
-  this->createDescriptorPool();
-  this->allocateDescriptorSets();
+  this->createDescriptorAllocator();
 }
 
 StandardMaterial::~StandardMaterial() {
@@ -58,12 +52,9 @@ StandardMaterial::~StandardMaterial() {
       this->pipeline = VK_NULL_HANDLE;
     }
 
-    if (this->descriptorPool != VK_NULL_HANDLE) {
-      vkDestroyDescriptorPool(
-          this->framework->getContext()->getDevice(),
-          this->descriptorPool,
-          nullptr);
-      this->descriptorPool = VK_NULL_HANDLE;
+    if (this->descriptorAllocator != nullptr) {
+      this->descriptorAllocator->destroy();
+      this->descriptorAllocator.reset();
     }
 
     if (this->descriptorSetLayout != VK_NULL_HANDLE) {
@@ -93,14 +84,31 @@ StandardMaterial::~StandardMaterial() {
 }
 
 VkPipelineLayout StandardMaterial::createPipelineLayout() {
+  std::vector<VkDescriptorSetLayout> setLayouts = {
+      this->descriptorSetLayout,
+  };
+
+  // Left unused by batch materials, which read their per draw data from
+  // their buffer
+  VkPushConstantRange pushConstantRange = {
+      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+      .offset = 0,
+      .size = sizeof(StandardPushConstants),
+  };
+
+  if (this->bindless) {
+    setLayouts.push_back(
+        this->framework->getTextureTable()->getDescriptorSetLayout());
+  }
+
   VkPipelineLayoutCreateInfo layoutCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .setLayoutCount = 1,
-      .pSetLayouts = &descriptorSetLayout,
-      .pushConstantRangeCount = 0,
-      .pPushConstantRanges = nullptr,
+      .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+      .pSetLayouts = setLayouts.data(),
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &pushConstantRange,
   };
 
   VkPipelineLayout pipelineLayout;
@@ -148,6 +156,25 @@ void StandardMaterial::createPipeline() {
   auto vertexAttributeDescriptions = Vertex::getVertexAttributeDescriptions(
       vertexBindingDescriptions[0].binding);
 
+  if (this->instanceInput != INSTANCE_INPUT_NONE) {
+    bool batch = this->instanceInput == INSTANCE_INPUT_BATCH;
+
+    vertexBindingDescriptions.push_back({
+        .binding = 1,
+        .stride = batch ? static_cast<uint32_t>(sizeof(BatchInstanceData))
+                        : static_cast<uint32_t>(sizeof(InstanceData)),
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+    });
+
+    auto instanceAttributeDescriptions =
+        batch ? BatchInstanceData::getVertexAttributeDescriptions(1)
+              : InstanceData::getVertexAttributeDescriptions(1);
+    vertexAttributeDescriptions.insert(
+        vertexAttributeDescriptions.end(),
+        instanceAttributeDescriptions.begin(),
+        instanceAttributeDescriptions.end());
+  }
+
   VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
       .pNext = nullptr,
@@ -253,7 +280,11 @@ void StandardMaterial::createPipeline() {
       .blendConstants = {0.0f, 0.0f, 0.0f, 0.0f},
   };
 
-  this->pipelineLayout = this->createPipelineLayout();
+  // The layout doesn't depend on the render pass, so it's kept when the
+  // pipeline is rebuilt
+  if (this->pipelineLayout == VK_NULL_HANDLE) {
+    this->pipelineLayout = this->createPipelineLayout();
+  }
 
   VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -279,7 +310,7 @@ void StandardMaterial::createPipeline() {
 
   if (vkCreateGraphicsPipelines(
           this->framework->getContext()->getDevice(),
-          VK_NULL_HANDLE,
+          this->framework->getContext()->getPipelineCache(),
           1,
           &pipelineCreateInfo,
           nullptr,
@@ -288,12 +319,16 @@ void StandardMaterial::createPipeline() {
         this->framework->getContext()->getDevice(),
         this->pipelineLayout,
         nullptr);
+    this->pipelineLayout = VK_NULL_HANDLE;
     throw std::runtime_error("Failed to create graphics pipeline");
   }
+
+  this->renderPassVersion =
+      this->framework->getContext()->getRenderPassVersion();
 }
 
 void StandardMaterial::createDescriptorSetLayout() {
-  std::array<VkDescriptorSetLayoutBinding, 2> layoutBindings = {
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {
       VkDescriptorSetLayoutBinding{
           .binding = 0,
           .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
@@ -303,13 +338,18 @@ void StandardMaterial::createDescriptorSetLayout() {
       },
       VkDescriptorSetLayoutBinding{
           .binding = 1,
-          .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          .descriptorType = this->bufferDescriptorType,
           .descriptorCount = 1,
           .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
           .pImmutableSamplers = nullptr,
       },
   };
 
+  // Textures come from the texture table's set
+  if (this->bindless) {
+    layoutBindings.erase(layoutBindings.begin());
+  }
+
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
       .pNext = nullptr,
@@ -327,54 +367,23 @@ void StandardMaterial::createDescriptorSetLayout() {
   }
 }
 
-void StandardMaterial::createDescriptorPool() {
-  std::array<VkDescriptorPoolSize, 2> poolSizes = {
+void StandardMaterial::createDescriptorAllocator() {
+  // Descriptors needed by a single set
+  std::vector<VkDescriptorPoolSize> poolSizes = {
       VkDescriptorPoolSize{
           .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
           .descriptorCount = 1,
       },
       VkDescriptorPoolSize{
-          .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          .type = this->bufferDescriptorType,
           .descriptorCount = 1,
       },
   };
 
-  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
-      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-      .pNext = nullptr,
-      .flags = 0,
-      .maxSets = MAX_DESCRIPTOR_SETS,
-      .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
-      .pPoolSizes = poolSizes.data(),
-  };
-
-  if (vkCreateDescriptorPool(
-          this->framework->getContext()->getDevice(),
-          &descriptorPoolCreateInfo,
-          nullptr,
-          &this->descriptorPool) != VK_SUCCESS) {
-    throw std::runtime_error("Failed to create descriptor pool");
+  if (this->bindless) {
+    poolSizes.erase(poolSizes.begin());
   }
-}
-
-void StandardMaterial::allocateDescriptorSets() {
-  this->descriptorSetAvailable.fill(true);
-
-  std::array<VkDescriptorSetLayout, MAX_DESCRIPTOR_SETS> setLayouts;
-  setLayouts.fill(this->descriptorSetLayout);
 
-  VkDescriptorSetAllocateInfo allocateInfo = {
-      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-      .pNext = nullptr,
-      .descriptorPool = this->descriptorPool,
-      .descriptorSetCount = MAX_DESCRIPTOR_SETS,
-      .pSetLayouts = setLayouts.data(),
-  };
-
-  if (vkAllocateDescriptorSets(
-          this->framework->getContext()->getDevice(),
-          &allocateInfo,
-          this->descriptorSets.data()) != VK_SUCCESS) {
-    throw std::runtime_error("Failed to allocate descriptor set");
-  }
+  this->descriptorAllocator.reset(new DescriptorAllocator(
+      this->framework, this->descriptorSetLayout, poolSizes));
 }
@@ -7,17 +7,52 @@
 #include <vulkan/vulkan.h>
 
 namespace vkf {
+// Per instance vertex input of a standard material, read from vertex
+// binding 1
+enum InstanceInput : uint32_t {
+  INSTANCE_INPUT_NONE = 0,
+  // InstanceData, for Mesh::drawInstanced
+  INSTANCE_INPUT_DATA = 1,
+  // BatchInstanceData, for batches drawn with the texture table
+  INSTANCE_INPUT_BATCH = 2,
+};
+
+// Per draw data of standard materials, pushed before every draw. Matches the
+// push constant block of their shaders.
+struct StandardPushConstants {
+  glm::mat4 model;
+  // Not used by the standard shaders, free for custom ones to index their
+  // own per draw data with
+  uint32_t drawIndex;
+  // Index into the framework's texture table, if it's enabled
+  uint32_t textureIndex;
+};
+
+// Draws a texture modulated by the vertex color. Binding 1 holds the
+// framework's camera matrices and the model matrix is a push constant. With
+// the texture table enabled, the texture is selected by a pushed table index.
 class StandardMaterial : public Material {
 public:
   StandardMaterial(Framework *framework);
   virtual ~StandardMaterial();
 
 protected:
+  // For materials that keep the standard pipeline and descriptor layout but
+  // use their own shaders. bufferDescriptorType is the type of binding 1.
+  StandardMaterial(
+      Framework *framework,
+      const char *vertexShaderPath,
+      const char *fragmentShaderPath,
+      VkDescriptorType bufferDescriptorType,
+      InstanceInput instanceInput = INSTANCE_INPUT_NONE);
+
+  VkDescriptorType bufferDescriptorType;
+  InstanceInput instanceInput;
+
   VkPipelineLayout createPipelineLayout() override;
   void createPipeline() override;
   void createDescriptorSetLayout() override;
-  void createDescriptorPool() override;
-  void allocateDescriptorSets() override;
+  void createDescriptorAllocator() override;
 };
 
 } // namespace vkf
@@ -1,7 +1,6 @@
 #include "mesh.hpp"
 #include "../framework/framework.hpp"
 #include <glm/gtc/matrix_transform.hpp>
-#include <stb_image.h>
 
 using namespace vkf;
 
@@ -10,78 +9,75 @@ Mesh::Mesh(
     std::vector<Vertex> vertices,
     std::vector<uint32_t> indices,
     const char *texturePath)
-    : framework(material->framework),
-      material(material),
-      vertices(vertices),
-      vertexBuffer(framework, vertices.size() * sizeof(Vertex)),
-      indices(indices),
-      indexBuffer(framework, indices.size() * sizeof(uint32_t)),
-      uniformBuffer(framework, sizeof(UniformBufferObject)) {
-  StagingBuffer *stagingBuffer = this->framework->getStagingBuffer();
-
-  // Vertices
-  {
-    stagingBuffer->copyMemory(
-        vertices.data(), vertices.size() * sizeof(Vertex));
-
-    stagingBuffer->transfer(vertexBuffer, vertices.size() * sizeof(Vertex));
-  }
+    : framework(material->framework), material(material) {
+  // Vertices and indices
+  this->geometry = this->framework->getGeometryPool()->allocate(
+      vertices.data(),
+      static_cast<uint32_t>(vertices.size()),
+      indices.data(),
+      static_cast<uint32_t>(indices.size()),
+      &this->uploadTicket);
 
-  // Indices
-  {
-    stagingBuffer->copyMemory(
-        indices.data(), indices.size() * sizeof(uint32_t));
+  this->boundingBox = BoundingBox::fromVertices(
+      vertices.data(), static_cast<uint32_t>(vertices.size()));
+  this->boundingSphere = BoundingSphere::fromVertices(
+      vertices.data(), static_cast<uint32_t>(vertices.size()));
 
-    stagingBuffer->transfer(indexBuffer, indices.size() * sizeof(uint32_t));
-  }
+  // Texture, decoded on the loader's worker threads
+  this->textureHandle =
+      this->framework->getTextureLoader()->load(texturePath);
+}
 
-  // Get a descriptor set
-  {
-    // TODO: more elegant way of reserving descriptor sets (queue maybe?)
-    this->descriptorSetIndex = this->material->getAvailableDescriptorSet();
-    if (descriptorSetIndex == -1) {
-      throw std::runtime_error("Failed to find available descriptor set");
-    }
-    this->material->descriptorSetAvailable[descriptorSetIndex] = false;
-  }
+Mesh::Mesh(
+    StandardMaterial *material,
+    AssetPack &pack,
+    const char *meshName,
+    const char *textureName)
+    : framework(material->framework), material(material) {
+  this->uploadTicket = pack.loadMesh(meshName, &this->geometry);
 
-  // Texture
-  {
-    uint32_t width, height;
-    std::vector<unsigned char> imageData =
-        Texture::loadDataFromFile(texturePath, &width, &height);
+  // Vertices come first in a mesh entry, loadMesh checked they fit
+  const AssetPackEntry &entry = pack.getEntry(meshName, ASSET_TYPE_MESH);
+  const Vertex *vertices =
+      reinterpret_cast<const Vertex *>(pack.getData(entry));
+  this->boundingBox = BoundingBox::fromVertices(vertices, entry.vertexCount);
+  this->boundingSphere =
+      BoundingSphere::fromVertices(vertices, entry.vertexCount);
 
-    this->texture = {this->framework, width, height};
+  this->textureHandle =
+      this->framework->getTextureLoader()->load(pack, textureName);
+}
 
-    stagingBuffer->copyMemory(
-        imageData.data(), imageData.size() * sizeof(unsigned char));
-    stagingBuffer->transfer(texture);
+Mesh::~Mesh() {
+  this->framework->getTextureLoader()->release(this->textureHandle);
+  this->framework->getGeometryPool()->free(this->geometry);
 
-    this->updateTextureDescriptor();
+  if (this->descriptorSet != VK_NULL_HANDLE) {
+    this->material->getDescriptorAllocator()->free(this->descriptorSet);
   }
 }
 
-Mesh::~Mesh() {
-  texture.destroy();
-  indexBuffer.destroy();
-  vertexBuffer.destroy();
-  uniformBuffer.destroy();
+void Mesh::updateTextureDescriptor() {
+  Texture *texture =
+      this->framework->getTextureLoader()->getTexture(this->textureHandle);
 
-  this->material->descriptorSetAvailable[descriptorSetIndex] = true;
+  if (texture != nullptr && this->descriptorSet != VK_NULL_HANDLE) {
+    this->writeTextureDescriptor(this->descriptorSet, texture);
+  }
 }
 
-void Mesh::updateTextureDescriptor() {
-  // Update descriptor set
+void Mesh::writeTextureDescriptor(
+    VkDescriptorSet descriptorSet, Texture *texture) {
   VkDescriptorImageInfo imageInfo = {
-      .sampler = this->texture.getSamplerHandle(),
-      .imageView = this->texture.getImageViewHandle(),
+      .sampler = texture->getSamplerHandle(),
+      .imageView = texture->getImageViewHandle(),
       .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
   };
 
   VkWriteDescriptorSet descriptorWrite{
       .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
       .pNext = nullptr,
-      .dstSet = this->material->descriptorSets[descriptorSetIndex],
+      .dstSet = descriptorSet,
       .dstBinding = 0,
       .dstArrayElement = 0,
       .descriptorCount = 1,
@@ -99,28 +95,75 @@ void Mesh::updateTextureDescriptor() {
       nullptr);
 }
 
-void Mesh::updateUniformDescriptor(UniformBufferObject ubo) {
-  // Send UBO data
-  StagingBuffer *stagingBuffer = this->framework->getStagingBuffer();
+void Mesh::setModel(const glm::mat4 &model) {
+  this->model = model;
+}
+
+void Mesh::setDrawIndex(uint32_t drawIndex) {
+  this->drawIndex = drawIndex;
+}
 
-  stagingBuffer->copyMemory(&ubo, sizeof(ubo));
-  stagingBuffer->transfer(uniformBuffer, sizeof(ubo));
+void Mesh::allocateDescriptorSet() {
+  this->descriptorSet = this->material->getDescriptorAllocator()->allocate();
+  this->writeUniformDescriptor(this->descriptorSet);
+}
+
+VkDescriptorSet Mesh::getDescriptorSet() {
+  // The texture is selected with a push constant instead, so every mesh of
+  // the material shares a set
+  if (this->material->bindless) {
+    return this->getPlaceholderDescriptorSet();
+  }
 
-  // Update descriptor set
+  if (this->descriptorSet == VK_NULL_HANDLE) {
+    if (!this->framework->getTextureLoader()->isResident(
+            this->textureHandle)) {
+      return this->getPlaceholderDescriptorSet();
+    }
+
+    // Written before any frame uses it, so it's never updated while in use
+    this->allocateDescriptorSet();
+    this->updateTextureDescriptor();
+  }
+
+  return this->descriptorSet;
+}
+
+VkDescriptorSet Mesh::getPlaceholderDescriptorSet() {
+  std::lock_guard<std::mutex> lock(this->material->placeholderMutex);
+
+  VkDescriptorSet &descriptorSet = this->material->placeholderDescriptorSet;
+  if (descriptorSet == VK_NULL_HANDLE) {
+    descriptorSet = this->material->getDescriptorAllocator()->allocate();
+
+    this->writeUniformDescriptor(descriptorSet);
+    if (!this->material->bindless) {
+      this->writeTextureDescriptor(
+          descriptorSet,
+          this->framework->getTextureLoader()->getPlaceholder());
+    }
+  }
+
+  return descriptorSet;
+}
+
+void Mesh::writeUniformDescriptor(VkDescriptorSet descriptorSet) {
+  // The offset is supplied as a dynamic offset when drawing, so this only
+  // needs to be written once
   VkDescriptorBufferInfo bufferInfo = {
-      .buffer = uniformBuffer.getHandle(),
+      .buffer = this->framework->getUniformRing()->getHandle(),
       .offset = 0,
-      .range = sizeof(UniformBufferObject),
+      .range = sizeof(CameraUniform),
   };
 
   VkWriteDescriptorSet descriptorWrite{
       .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
       .pNext = nullptr,
-      .dstSet = this->material->descriptorSets[descriptorSetIndex],
+      .dstSet = descriptorSet,
       .dstBinding = 1,
       .dstArrayElement = 0,
       .descriptorCount = 1,
-      .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
       .pImageInfo = nullptr,
       .pBufferInfo = &bufferInfo,
       .pTexelBufferView = nullptr,
@@ -134,22 +177,133 @@ void Mesh::updateUniformDescriptor(UniformBufferObject ubo) {
       nullptr);
 }
 
+bool Mesh::isResident() const {
+  return this->framework->getUploadQueue()->isComplete(this->uploadTicket) &&
+         this->framework->getTextureLoader()->isResident(this->textureHandle);
+}
+
+bool Mesh::isGeometryResident() const {
+  return this->framework->getUploadQueue()->isComplete(this->uploadTicket);
+}
+
+GeometryHandle Mesh::getGeometry() const {
+  return this->geometry;
+}
+
+const BoundingBox &Mesh::getBoundingBox() const {
+  return this->boundingBox;
+}
+
+const BoundingSphere &Mesh::getBoundingSphere() const {
+  return this->boundingSphere;
+}
+
+Texture *Mesh::getTexture() {
+  TextureLoader *textureLoader = this->framework->getTextureLoader();
+
+  Texture *texture = textureLoader->getTexture(this->textureHandle);
+  if (texture == nullptr) {
+    return textureLoader->getPlaceholder();
+  }
+
+  return texture;
+}
+
 void Mesh::draw(VkCommandBuffer commandBuffer) {
+  // Skip drawing until the mesh's geometry is done uploading, the texture
+  // can be stood in for
+  if (!this->isGeometryResident()) {
+    return;
+  }
+
+  this->bindDescriptorSet(commandBuffer);
+  this->drawGeometry(commandBuffer, 1);
+}
+
+void Mesh::drawInstanced(
+    VkCommandBuffer commandBuffer,
+    const InstanceData *instances,
+    uint32_t instanceCount) {
+  if (!this->isGeometryResident() || instanceCount == 0) {
+    return;
+  }
+
+  RingBuffer *instanceRing = this->framework->getInstanceRing();
+  VkDeviceSize offset = instanceRing->allocate(
+      instances, static_cast<size_t>(instanceCount) * sizeof(InstanceData));
+  VkBuffer instanceBufferHandle = instanceRing->getHandle();
+
+  this->bindDescriptorSet(commandBuffer);
+  vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBufferHandle, &offset);
+  this->drawGeometry(commandBuffer, instanceCount);
+}
+
+void Mesh::drawInstanced(
+    VkCommandBuffer commandBuffer,
+    VertexBuffer &instanceBuffer,
+    uint32_t instanceCount,
+    VkDeviceSize offset) {
+  if (!this->isGeometryResident() || instanceCount == 0) {
+    return;
+  }
+
+  VkBuffer instanceBufferHandle = instanceBuffer.getHandle();
+
+  this->bindDescriptorSet(commandBuffer);
+  vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBufferHandle, &offset);
+  this->drawGeometry(commandBuffer, instanceCount);
+}
+
+void Mesh::bindDescriptorSet(VkCommandBuffer commandBuffer) {
+  VkDescriptorSet descriptorSet = this->getDescriptorSet();
+  uint32_t cameraOffset = this->framework->getCameraOffset();
+
   vkCmdBindDescriptorSets(
       commandBuffer,
       VK_PIPELINE_BIND_POINT_GRAPHICS,
       this->material->pipelineLayout,
       0,
       1,
-      &this->material->descriptorSets[this->descriptorSetIndex],
+      &descriptorSet,
+      1,
+      &cameraOffset);
+
+  this->pushConstants(commandBuffer, this->model);
+}
+
+void Mesh::pushConstants(
+    VkCommandBuffer commandBuffer, const glm::mat4 &model) {
+  StandardPushConstants pushConstants = {
+      .model = model,
+      .drawIndex = this->drawIndex,
+      .textureIndex = 0,
+  };
+
+  if (this->material->bindless) {
+    pushConstants.textureIndex =
+        this->framework->getTextureTable()->getIndex(this->getTexture());
+  }
+
+  vkCmdPushConstants(
+      commandBuffer,
+      this->material->pipelineLayout,
+      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
       0,
-      nullptr);
+      sizeof(pushConstants),
+      &pushConstants);
+}
 
-  VkDeviceSize offset = 0;
-  VkBuffer vertexBufferHandle = this->vertexBuffer.getHandle();
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBufferHandle, &offset);
-  vkCmdBindIndexBuffer(
-      commandBuffer, this->indexBuffer.getHandle(), 0, VK_INDEX_TYPE_UINT32);
+void Mesh::drawGeometry(VkCommandBuffer commandBuffer, uint32_t instanceCount) {
+  // Every mesh shares the pool's buffers, only the offsets differ
+  GeometryPool *geometryPool = this->framework->getGeometryPool();
+  geometryPool->bind(commandBuffer);
 
-  vkCmdDrawIndexed(commandBuffer, this->indices.size(), 1, 0, 0, 0);
+  GeometryRange range = geometryPool->getRange(this->geometry);
+  vkCmdDrawIndexed(
+      commandBuffer,
+      range.indexCount,
+      instanceCount,
+      range.firstIndex,
+      static_cast<int32_t>(range.vertexOffset),
+      0);
 }
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "../asset/asset_pack.hpp"
+#include "../buffer/geometry_pool.hpp"
+#include "../buffer/upload_queue.hpp"
 #include "../buffer/vertex_buffer.hpp"
-#include "../buffer/index_buffer.hpp"
-#include "../buffer/uniform_buffer.hpp"
+#include "../culling/bounds.hpp"
 #include "../material/standard_material.hpp"
 #include "../texture/texture.hpp"
+#include "../texture/texture_loader.hpp"
 #include "vertex.hpp"
 #include <stb_image.h>
 #include <vk_mem_alloc.h>
@@ -12,40 +15,120 @@
 namespace vkf {
 class Framework;
 
-struct UniformBufferObject {
-  glm::mat4 model;
-  glm::mat4 view;
-  glm::mat4 proj;
-};
-
+// Mesh with a single texture. The texture is loaded in the background, and
+// the mesh is drawn with the loader's placeholder texture until it's resident.
+// If the material reads textures from the texture table, meshes share one
+// descriptor set and push their texture's index instead of owning a set.
 class Mesh {
+  friend class RenderQueue;
+
 public:
   Mesh(
       StandardMaterial *material,
       std::vector<Vertex> vertices,
       std::vector<uint32_t> indices,
       const char *texturePath);
+
+  // Creates a mesh from a mesh entry and a texture entry of an asset pack,
+  // uploading both straight from the mapped pack
+  Mesh(
+      StandardMaterial *material,
+      AssetPack &pack,
+      const char *meshName,
+      const char *textureName);
   ~Mesh();
 
+  // Points the mesh's descriptor set at its texture. Called on the first
+  // draw after the texture became resident.
   void updateTextureDescriptor();
-  void updateUniformDescriptor(UniformBufferObject ubo);
+
+  // Sets the model matrix pushed with every draw. The view and projection
+  // come from the framework's camera.
+  void setModel(const glm::mat4 &model);
+
+  // Sets the draw index pushed with every draw, for custom shaders
+  void setDrawIndex(uint32_t drawIndex);
+
+  // Returns true once the mesh's vertices, indices and texture are uploaded
+  bool isResident() const;
+
+  // Returns true once the mesh's vertices and indices are uploaded
+  bool isGeometryResident() const;
+
+  GeometryHandle getGeometry() const;
+
+  // Bounds of the mesh's vertices, in model space
+  const BoundingBox &getBoundingBox() const;
+  const BoundingSphere &getBoundingSphere() const;
+
+  // Returns the mesh's texture, or the placeholder until it's resident
+  Texture *getTexture();
 
   void draw(VkCommandBuffer commandBuffer);
 
+  // Draws the mesh once per instance with a single call. The instances are
+  // copied into this frame's region of the instance ring. The mesh's
+  // material must be an InstancedMaterial.
+  void drawInstanced(
+      VkCommandBuffer commandBuffer,
+      const InstanceData *instances,
+      uint32_t instanceCount);
+
+  // Draws the mesh once per instance read from a buffer the caller keeps
+  // alive, e.g. static foliage uploaded once through the upload queue
+  void drawInstanced(
+      VkCommandBuffer commandBuffer,
+      VertexBuffer &instanceBuffer,
+      uint32_t instanceCount,
+      VkDeviceSize offset = 0);
+
 protected:
   Framework *framework;
   StandardMaterial *material;
 
-  int descriptorSetIndex = -1;
+  // Only allocated once the texture is resident, until then the material's
+  // placeholder descriptor set is used
+  VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+
+  UploadTicket uploadTicket = 0;
+
+  // Vertices and indices, sub-allocated from the framework's geometry pool
+  GeometryHandle geometry = 0;
+
+  BoundingBox boundingBox;
+  BoundingSphere boundingSphere;
+
+  glm::mat4 model{1.0f};
+  uint32_t drawIndex = 0;
+
+  TextureHandle textureHandle = 0;
+
+  // Allocates a descriptor set from the material and writes its uniform
+  // binding
+  void allocateDescriptorSet();
+
+  // Returns the descriptor set to draw with, switching from the placeholder
+  // to the mesh's own set once the texture is resident
+  VkDescriptorSet getDescriptorSet();
+
+  // Returns the material's descriptor set pointing at the placeholder
+  // texture, shared by every mesh whose texture isn't resident yet
+  VkDescriptorSet getPlaceholderDescriptorSet();
+
+  void writeTextureDescriptor(VkDescriptorSet descriptorSet, Texture *texture);
 
-  std::vector<Vertex> vertices;
-  VertexBuffer vertexBuffer;
+  // Points a descriptor set's dynamic uniform binding at the camera
+  // matrices in the uniform ring
+  void writeUniformDescriptor(VkDescriptorSet descriptorSet);
 
-  std::vector<uint32_t> indices;
-  IndexBuffer indexBuffer;
+  // Binds the mesh's descriptor set at this frame's camera matrices, and
+  // pushes the mesh's model matrix, draw index and texture index
+  void bindDescriptorSet(VkCommandBuffer commandBuffer);
 
-  UniformBuffer uniformBuffer;
+  // Pushes a model matrix with the mesh's draw index and texture index
+  void pushConstants(VkCommandBuffer commandBuffer, const glm::mat4 &model);
 
-  Texture texture;
+  // Binds the geometry pool and draws the mesh's range
+  void drawGeometry(VkCommandBuffer commandBuffer, uint32_t instanceCount);
 };
 } // namespace vkf
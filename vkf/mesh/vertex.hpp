@@ -37,4 +37,56 @@ struct Vertex {
     return vertexAttributeDescriptions;
   }
 };
+
+// Per instance data of instanced draws, follows the vertex attributes
+struct InstanceData {
+  glm::mat4 transform;
+  glm::vec3 tint;
+
+  static std::vector<VkVertexInputAttributeDescription>
+  getVertexAttributeDescriptions(const uint32_t binding) {
+    std::vector<VkVertexInputAttributeDescription> vertexAttributeDescriptions;
+
+    // A mat4 attribute takes one location per column
+    for (uint32_t i = 0; i < 4; i++) {
+      vertexAttributeDescriptions.push_back({
+          .location = 3 + i,
+          .binding = binding,
+          .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+          .offset = static_cast<uint32_t>(
+              offsetof(InstanceData, transform) + i * sizeof(glm::vec4)),
+      });
+    }
+
+    vertexAttributeDescriptions.push_back({
+        .location = 7,
+        .binding = binding,
+        .format = VK_FORMAT_R32G32B32_SFLOAT,
+        .offset = offsetof(InstanceData, tint),
+    });
+
+    return vertexAttributeDescriptions;
+  }
+};
+
+// Per draw data of batches drawn with the texture table. Selected by the
+// draw's firstInstance, like its model matrix.
+struct BatchInstanceData {
+  uint32_t textureIndex;
+
+  static std::vector<VkVertexInputAttributeDescription>
+  getVertexAttributeDescriptions(const uint32_t binding) {
+    std::vector<VkVertexInputAttributeDescription> vertexAttributeDescriptions =
+        {
+            {
+                .location = 3,
+                .binding = binding,
+                .format = VK_FORMAT_R32_UINT,
+                .offset = offsetof(BatchInstanceData, textureIndex),
+            },
+        };
+
+    return vertexAttributeDescriptions;
+  }
+};
 } // namespace vkf
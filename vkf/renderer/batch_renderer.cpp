@@ -0,0 +1,615 @@
+#include "batch_renderer.hpp"
+#include "../framework/framework.hpp"
+#include "../mesh/mesh.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+using namespace vkf;
+
+// Size of the per group draw counts at the start of a culled buffer region
+const size_t CULLED_COUNTS_SIZE = MAX_BATCH_DRAWS * sizeof(uint32_t);
+
+// Size of a frame in flight's region of the culled buffer, a multiple of any
+// storage buffer offset alignment
+const size_t CULLED_REGION_SIZE =
+    CULLED_COUNTS_SIZE +
+    MAX_BATCH_DRAWS * sizeof(VkDrawIndexedIndirectCommand);
+
+BatchRenderer::BatchRenderer(Framework *framework, BatchMaterial *material)
+    : framework(framework),
+      material(material),
+      drawDataRing(
+          framework,
+          (MAX_BATCH_DRAWS + 2) * sizeof(glm::mat4),
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT),
+      indirectRing(
+          framework,
+          MAX_BATCH_DRAWS * sizeof(VkDrawIndexedIndirectCommand),
+          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+  if (this->material->bindless) {
+    this->instanceDataRing.reset(new RingBuffer(
+        framework,
+        MAX_BATCH_DRAWS * sizeof(BatchInstanceData),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT));
+  }
+}
+
+BatchRenderer::~BatchRenderer() {
+  for (const auto &entry : this->descriptorSets) {
+    this->material->getDescriptorAllocator()->free(entry.second);
+  }
+
+  if (this->culledBuffer != nullptr) {
+    this->culledBuffer->destroy();
+  }
+  if (this->cullDataRing != nullptr) {
+    this->cullDataRing->destroy();
+  }
+  if (this->instanceDataRing != nullptr) {
+    this->instanceDataRing->destroy();
+  }
+
+  this->indirectRing.destroy();
+  this->drawDataRing.destroy();
+}
+
+void BatchRenderer::setCamera(
+    const glm::mat4 &view, const glm::mat4 &projection) {
+  this->view = view;
+  this->projection = projection;
+}
+
+bool BatchRenderer::isGpuCullingSupported() const {
+  return this->framework->getContext()
+      ->getEnabledFeatures()
+      .drawIndirectFirstInstance;
+}
+
+void BatchRenderer::setGpuCulling(bool enabled) {
+  if (enabled && !this->isGpuCullingSupported()) {
+    throw std::runtime_error(
+        "GPU culling needs the drawIndirectFirstInstance feature");
+  }
+
+  this->gpuCulling = enabled;
+
+  if (!enabled || this->cullPipeline != nullptr) {
+    return;
+  }
+
+  std::vector<VkDescriptorSetLayoutBinding> bindings;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    bindings.push_back({
+        .binding = binding,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .pImmutableSamplers = nullptr,
+    });
+  }
+
+  this->cullPipeline.reset(new ComputePipeline(
+      this->framework,
+      "shaders/cull.comp.spv",
+      bindings,
+      sizeof(CullPushConstants),
+      1));
+
+  this->cullDataRing.reset(new RingBuffer(
+      this->framework,
+      MAX_BATCH_DRAWS * sizeof(CullData),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT));
+
+  this->culledBuffer.reset(new StorageBuffer(
+      this->framework,
+      CULLED_REGION_SIZE * MAX_FRAMES_IN_FLIGHT,
+      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT));
+
+  this->cullDescriptorSet = this->cullPipeline->allocateDescriptorSet();
+
+  // Every buffer's frame region is selected with a dynamic offset, so this
+  // only needs to be written once
+  std::array<VkDescriptorBufferInfo, 3> bufferInfos = {
+      VkDescriptorBufferInfo{
+          .buffer = this->drawDataRing.getHandle(),
+          .offset = 0,
+          .range = this->drawDataRing.getFrameSize(),
+      },
+      VkDescriptorBufferInfo{
+          .buffer = this->cullDataRing->getHandle(),
+          .offset = 0,
+          .range = this->cullDataRing->getFrameSize(),
+      },
+      VkDescriptorBufferInfo{
+          .buffer = this->culledBuffer->getHandle(),
+          .offset = 0,
+          .range = CULLED_REGION_SIZE,
+      },
+  };
+
+  std::vector<VkWriteDescriptorSet> descriptorWrites;
+  for (uint32_t binding = 0; binding < bufferInfos.size(); binding++) {
+    descriptorWrites.push_back({
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = nullptr,
+        .dstSet = this->cullDescriptorSet,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+        .pImageInfo = nullptr,
+        .pBufferInfo = &bufferInfos[binding],
+        .pTexelBufferView = nullptr,
+    });
+  }
+
+  vkUpdateDescriptorSets(
+      this->framework->getContext()->getDevice(),
+      static_cast<uint32_t>(descriptorWrites.size()),
+      descriptorWrites.data(),
+      0,
+      nullptr);
+}
+
+void BatchRenderer::add(
+    GeometryHandle geometry, Texture *texture, const glm::mat4 &model) {
+  this->draws.push_back({
+      .geometry = geometry,
+      .texture = texture,
+      .imageView = texture->getImageViewHandle(),
+      .model = model,
+      .bounds = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f),
+  });
+}
+
+void BatchRenderer::add(
+    GeometryHandle geometry,
+    Texture *texture,
+    const glm::mat4 &model,
+    const BoundingSphere &bounds) {
+  this->draws.push_back({
+      .geometry = geometry,
+      .texture = texture,
+      .imageView = texture->getImageViewHandle(),
+      .model = model,
+      .bounds = glm::vec4(bounds.center, bounds.radius),
+  });
+}
+
+void BatchRenderer::add(Mesh &mesh, const glm::mat4 &model) {
+  if (!mesh.isGeometryResident()) {
+    return;
+  }
+
+  this->add(
+      mesh.getGeometry(), mesh.getTexture(), model, mesh.getBoundingSphere());
+}
+
+void BatchRenderer::prepare() {
+  if (this->prepared) {
+    return;
+  }
+  this->prepared = true;
+
+  this->groups.clear();
+
+  if (this->draws.empty()) {
+    return;
+  }
+
+  if (this->draws.size() > MAX_BATCH_DRAWS) {
+    this->draws.clear();
+    throw std::runtime_error("Too many batched draws in a single frame");
+  }
+
+  uint32_t drawCount = static_cast<uint32_t>(this->draws.size());
+
+  if (this->material->bindless) {
+    // Every draw selects its own texture, so they all share a call
+    TextureTable *textureTable = this->framework->getTextureTable();
+
+    this->instanceData.clear();
+    for (const Draw &draw : this->draws) {
+      this->instanceData.push_back({textureTable->getIndex(draw.texture)});
+    }
+
+    this->instanceDataOffset = this->instanceDataRing->allocate(
+        this->instanceData.data(),
+        this->instanceData.size() * sizeof(BatchInstanceData));
+
+    this->groups.push_back({0, drawCount});
+  } else {
+    // Draws sharing a texture end up next to each other, so they share a
+    // call
+    std::stable_sort(
+        this->draws.begin(),
+        this->draws.end(),
+        [](const Draw &a, const Draw &b) {
+          return a.imageView < b.imageView;
+        });
+
+    for (uint32_t first = 0; first < drawCount;) {
+      uint32_t last = first + 1;
+      while (last < drawCount &&
+             this->draws[last].imageView == this->draws[first].imageView) {
+        last++;
+      }
+
+      this->groups.push_back({first, last - first});
+      first = last;
+    }
+  }
+
+  this->drawData.clear();
+  this->drawData.push_back(this->view);
+  this->drawData.push_back(this->projection);
+  for (const Draw &draw : this->draws) {
+    this->drawData.push_back(draw.model);
+  }
+
+  this->drawDataOffset = this->drawDataRing.allocate(
+      this->drawData.data(), this->drawData.size() * sizeof(glm::mat4));
+}
+
+void BatchRenderer::writeCommands() {
+  GeometryPool *geometryPool = this->framework->getGeometryPool();
+
+  this->commands.clear();
+  for (uint32_t i = 0; i < this->draws.size(); i++) {
+    GeometryRange range = geometryPool->getRange(this->draws[i].geometry);
+
+    // firstInstance selects the draw's model matrix in the shader
+    this->commands.push_back({
+        .indexCount = range.indexCount,
+        .instanceCount = 1,
+        .firstIndex = range.firstIndex,
+        .vertexOffset = static_cast<int32_t>(range.vertexOffset),
+        .firstInstance = i,
+    });
+  }
+
+  this->commandsOffset = this->indirectRing.allocate(
+      this->commands.data(),
+      this->commands.size() * sizeof(VkDrawIndexedIndirectCommand));
+}
+
+bool BatchRenderer::canCompact() const {
+  VkContext *context = this->framework->getContext();
+
+  // Every group has to fit in a single counted call
+  return context->getDrawIndexedIndirectCount() != nullptr &&
+         context->getEnabledFeatures().multiDrawIndirect &&
+         context->getPhysicalDeviceProperties().limits.maxDrawIndirectCount >=
+             MAX_BATCH_DRAWS;
+}
+
+VkDeviceSize BatchRenderer::getCulledRegionOffset() const {
+  return static_cast<VkDeviceSize>(
+             this->framework->getContext()->getCurrentFrame()) *
+         CULLED_REGION_SIZE;
+}
+
+void BatchRenderer::cull(VkCommandBuffer commandBuffer) {
+  if (!this->gpuCulling) {
+    return;
+  }
+
+  this->prepare();
+
+  if (this->draws.empty()) {
+    return;
+  }
+
+  // The culling pass writes the commands itself, from the draws' ranges and
+  // bounds
+  GeometryPool *geometryPool = this->framework->getGeometryPool();
+
+  this->cullData.clear();
+  for (uint32_t group = 0; group < this->groups.size(); group++) {
+    const Group &run = this->groups[group];
+    for (uint32_t i = run.first; i < run.first + run.count; i++) {
+      GeometryRange range = geometryPool->getRange(this->draws[i].geometry);
+      this->cullData.push_back({
+          .bounds = this->draws[i].bounds,
+          .indexCount = range.indexCount,
+          .firstIndex = range.firstIndex,
+          .vertexOffset = static_cast<int32_t>(range.vertexOffset),
+          .group = group,
+          .groupFirst = run.first,
+          .padding = {0, 0, 0},
+      });
+    }
+  }
+
+  this->cullDataOffset = this->cullDataRing->allocate(
+      this->cullData.data(), this->cullData.size() * sizeof(CullData));
+
+  this->compact = this->canCompact();
+
+  VkDeviceSize regionOffset = this->getCulledRegionOffset();
+
+  if (this->compact) {
+    vkCmdFillBuffer(
+        commandBuffer,
+        this->culledBuffer->getHandle(),
+        regionOffset,
+        this->groups.size() * sizeof(uint32_t),
+        0);
+
+    VkMemoryBarrier fillBarrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask =
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &fillBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+
+  Frustum frustum(this->projection * this->view);
+
+  CullPushConstants pushConstants;
+  for (size_t i = 0; i < frustum.getPlanes().size(); i++) {
+    pushConstants.planes[i] = frustum.getPlanes()[i];
+  }
+  pushConstants.drawCount = static_cast<uint32_t>(this->draws.size());
+  pushConstants.compact = this->compact ? 1 : 0;
+  pushConstants.commandsOffset = CULLED_COUNTS_SIZE / sizeof(uint32_t);
+
+  this->cullPipeline->bind(commandBuffer);
+  this->cullPipeline->bindDescriptorSet(
+      commandBuffer,
+      this->cullDescriptorSet,
+      {
+          this->drawDataOffset,
+          this->cullDataOffset,
+          static_cast<uint32_t>(regionOffset),
+      });
+  this->cullPipeline->pushConstants(
+      commandBuffer, &pushConstants, sizeof(pushConstants));
+  this->cullPipeline->dispatch(
+      commandBuffer, pushConstants.drawCount, CULL_GROUP_SIZE);
+
+  VkMemoryBarrier cullBarrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+  };
+
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+      0,
+      1,
+      &cullBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+
+  this->culled = true;
+}
+
+void BatchRenderer::draw(VkCommandBuffer commandBuffer) {
+  this->drawCallCount = 0;
+
+  this->prepare();
+
+  if (!this->culled && !this->draws.empty()) {
+    this->writeCommands();
+  }
+
+  if (!this->draws.empty()) {
+    GeometryPool *geometryPool = this->framework->getGeometryPool();
+
+    this->material->bindPipeline(commandBuffer);
+    geometryPool->bind(commandBuffer);
+
+    if (this->material->bindless) {
+      VkBuffer instanceDataBuffer = this->instanceDataRing->getHandle();
+      vkCmdBindVertexBuffers(
+          commandBuffer,
+          1,
+          1,
+          &instanceDataBuffer,
+          &this->instanceDataOffset);
+    }
+
+    VkDeviceSize regionOffset = this->getCulledRegionOffset();
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount =
+        this->framework->getContext()->getDrawIndexedIndirectCount();
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    for (uint32_t group = 0; group < this->groups.size(); group++) {
+      const Group &run = this->groups[group];
+
+      VkDescriptorSet descriptorSet =
+          this->getDescriptorSet(this->draws[run.first].texture);
+
+      vkCmdBindDescriptorSets(
+          commandBuffer,
+          VK_PIPELINE_BIND_POINT_GRAPHICS,
+          this->material->pipelineLayout,
+          0,
+          1,
+          &descriptorSet,
+          1,
+          &this->drawDataOffset);
+
+      if (!this->culled) {
+        this->recordDraws(
+            commandBuffer,
+            this->indirectRing.getHandle(),
+            this->commandsOffset,
+            run.first,
+            run.count);
+      } else if (this->compact) {
+        // The visible draws of the group were packed to its start and
+        // counted
+        drawIndexedIndirectCount(
+            commandBuffer,
+            this->culledBuffer->getHandle(),
+            regionOffset + CULLED_COUNTS_SIZE +
+                static_cast<VkDeviceSize>(run.first) * stride,
+            this->culledBuffer->getHandle(),
+            regionOffset + group * sizeof(uint32_t),
+            run.count,
+            stride);
+        this->drawCallCount++;
+      } else {
+        this->recordDraws(
+            commandBuffer,
+            this->culledBuffer->getHandle(),
+            regionOffset + CULLED_COUNTS_SIZE,
+            run.first,
+            run.count);
+      }
+    }
+  }
+
+  this->draws.clear();
+  this->prepared = false;
+  this->culled = false;
+}
+
+void BatchRenderer::releaseTexture(Texture *texture) {
+  auto it = this->descriptorSets.find(texture->getImageViewHandle());
+  if (it == this->descriptorSets.end()) {
+    return;
+  }
+
+  this->material->getDescriptorAllocator()->free(it->second);
+  this->descriptorSets.erase(it);
+}
+
+uint32_t BatchRenderer::getDrawCallCount() const {
+  return this->drawCallCount;
+}
+
+VkDescriptorSet BatchRenderer::getDescriptorSet(Texture *texture) {
+  VkImageView key =
+      this->material->bindless ? VK_NULL_HANDLE : texture->getImageViewHandle();
+
+  auto it = this->descriptorSets.find(key);
+  if (it != this->descriptorSets.end()) {
+    return it->second;
+  }
+
+  VkDescriptorSet descriptorSet =
+      this->material->getDescriptorAllocator()->allocate();
+  this->descriptorSets[key] = descriptorSet;
+
+  // The frame's region is selected with a dynamic offset, so this only needs
+  // to be written once
+  VkDescriptorBufferInfo bufferInfo = {
+      .buffer = this->drawDataRing.getHandle(),
+      .offset = 0,
+      .range = this->drawDataRing.getFrameSize(),
+  };
+
+  VkDescriptorImageInfo imageInfo = {
+      .sampler = texture->getSamplerHandle(),
+      .imageView = texture->getImageViewHandle(),
+      .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+  };
+
+  std::vector<VkWriteDescriptorSet> descriptorWrites = {
+      VkWriteDescriptorSet{
+          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .pNext = nullptr,
+          .dstSet = descriptorSet,
+          .dstBinding = 1,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+          .pImageInfo = nullptr,
+          .pBufferInfo = &bufferInfo,
+          .pTexelBufferView = nullptr,
+      },
+  };
+
+  // Bindless materials read the texture from the texture table
+  if (!this->material->bindless) {
+    descriptorWrites.push_back({
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = nullptr,
+        .dstSet = descriptorSet,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &imageInfo,
+        .pBufferInfo = nullptr,
+        .pTexelBufferView = nullptr,
+    });
+  }
+
+  vkUpdateDescriptorSets(
+      this->framework->getContext()->getDevice(),
+      static_cast<uint32_t>(descriptorWrites.size()),
+      descriptorWrites.data(),
+      0,
+      nullptr);
+
+  return descriptorSet;
+}
+
+void BatchRenderer::recordDraws(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkDeviceSize offset,
+    uint32_t first,
+    uint32_t count) {
+  VkContext *context = this->framework->getContext();
+  const VkPhysicalDeviceFeatures &features = context->getEnabledFeatures();
+  const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+  // Without drawIndirectFirstInstance, indirect draws must have a
+  // firstInstance of 0, so the commands are issued directly. GPU culling
+  // isn't supported then, so they are always the CPU written ones.
+  if (!features.drawIndirectFirstInstance) {
+    for (uint32_t i = first; i < first + count; i++) {
+      const VkDrawIndexedIndirectCommand &command = this->commands[i];
+      vkCmdDrawIndexed(
+          commandBuffer,
+          command.indexCount,
+          command.instanceCount,
+          command.firstIndex,
+          command.vertexOffset,
+          command.firstInstance);
+      this->drawCallCount++;
+    }
+    return;
+  }
+
+  uint32_t maxDrawCount = 1;
+  if (features.multiDrawIndirect) {
+    maxDrawCount =
+        context->getPhysicalDeviceProperties().limits.maxDrawIndirectCount;
+  }
+
+  for (uint32_t i = first; i < first + count; i += maxDrawCount) {
+    vkCmdDrawIndexedIndirect(
+        commandBuffer,
+        buffer,
+        offset + static_cast<VkDeviceSize>(i) * stride,
+        std::min(maxDrawCount, first + count - i),
+        stride);
+    this->drawCallCount++;
+  }
+}
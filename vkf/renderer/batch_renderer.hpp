@@ -0,0 +1,196 @@
+#pragma once
+
+#include "../buffer/geometry_pool.hpp"
+#include "../buffer/ring_buffer.hpp"
+#include "../buffer/storage_buffer.hpp"
+#include "../culling/bounds.hpp"
+#include "../culling/frustum.hpp"
+#include "../material/batch_material.hpp"
+#include "../material/compute_pipeline.hpp"
+#include "../texture/texture.hpp"
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+class Mesh;
+
+// Maximum number of draws a batch renderer records in a frame
+const uint32_t MAX_BATCH_DRAWS = 256 * 1024;
+
+// Invocations per work group of the culling shader
+const uint32_t CULL_GROUP_SIZE = 64;
+
+// Draws meshes sharing a BatchMaterial with as few calls as possible. Every
+// frame the queued draws are sorted by texture, their model matrices are
+// written to a storage buffer and their draw commands to an indirect buffer,
+// and the draws of each texture are issued with one vkCmdDrawIndexedIndirect.
+// If the material reads textures from the texture table, draws aren't sorted
+// and every draw's texture index is written to a vertex buffer instead, so
+// the whole batch is issued at once.
+//
+// With GPU culling enabled, the draw commands are instead written by a
+// compute pass that tests every draw's bounding sphere against the camera's
+// frustum. If VK_KHR_draw_indirect_count is supported the visible draws are
+// compacted and counted, otherwise culled draws get an instance count of 0.
+class BatchRenderer {
+public:
+  BatchRenderer(Framework *framework, BatchMaterial *material);
+  BatchRenderer(const BatchRenderer &) = delete;
+  BatchRenderer &operator=(const BatchRenderer &) = delete;
+  ~BatchRenderer();
+
+  void setCamera(const glm::mat4 &view, const glm::mat4 &projection);
+
+  // Returns true if the device can draw the commands written by the culling
+  // pass, which needs the drawIndirectFirstInstance feature
+  bool isGpuCullingSupported() const;
+
+  // Enables culling on the GPU. cull must then be recorded every frame
+  // before the render pass, draws are left unculled in frames it wasn't.
+  void setGpuCulling(bool enabled);
+
+  // Queues a draw of geometry from the framework's geometry pool. Draws
+  // without bounds are never culled.
+  void add(GeometryHandle geometry, Texture *texture, const glm::mat4 &model);
+  void add(
+      GeometryHandle geometry,
+      Texture *texture,
+      const glm::mat4 &model,
+      const BoundingSphere &bounds);
+
+  // Queues a draw of a mesh, skipped until its geometry is uploaded. Its
+  // texture is stood in for by the placeholder until it's resident.
+  void add(Mesh &mesh, const glm::mat4 &model);
+
+  // Gives the descriptor set used for a texture back to the material. Must be
+  // called before a texture that was drawn is destroyed, unless the material
+  // is bindless.
+  void releaseTexture(Texture *texture);
+
+  // Records the culling pass of the queued draws. Must be called outside of
+  // the render pass, e.g. from VkContext::present's pre-pass function.
+  void cull(VkCommandBuffer commandBuffer);
+
+  // Records every queued draw and clears them. Must be called once per frame,
+  // inside the render pass.
+  void draw(VkCommandBuffer commandBuffer);
+
+  // Returns the number of draw calls recorded by the last draw
+  uint32_t getDrawCallCount() const;
+
+private:
+  Framework *framework{nullptr};
+  BatchMaterial *material{nullptr};
+
+  // View and projection matrices followed by one model matrix per draw
+  RingBuffer drawDataRing;
+  // One VkDrawIndexedIndirectCommand per draw
+  RingBuffer indirectRing;
+  // One BatchInstanceData per draw, only created if the material is bindless
+  std::unique_ptr<RingBuffer> instanceDataRing;
+
+  glm::mat4 view{1.0f};
+  glm::mat4 projection{1.0f};
+
+  struct Draw {
+    GeometryHandle geometry;
+    Texture *texture;
+    VkImageView imageView;
+    glm::mat4 model;
+    // Model space center and radius, a negative radius is never culled
+    glm::vec4 bounds;
+  };
+
+  std::vector<Draw> draws;
+
+  // Runs of sorted draws sharing a texture, a single run if bindless
+  struct Group {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  // Reused every frame, to avoid reallocating them
+  std::vector<glm::mat4> drawData;
+  std::vector<VkDrawIndexedIndirectCommand> commands;
+  std::vector<BatchInstanceData> instanceData;
+  std::vector<Group> groups;
+
+  // Whether this frame's draws were sorted and their model matrices written
+  bool prepared = false;
+  uint32_t drawDataOffset = 0;
+  VkDeviceSize instanceDataOffset = 0;
+  uint32_t commandsOffset = 0;
+
+  // Descriptor set of every texture drawn so far, keyed by its image view.
+  // Bindless materials use a single set, keyed by VK_NULL_HANDLE.
+  std::map<VkImageView, VkDescriptorSet> descriptorSets;
+
+  uint32_t drawCallCount = 0;
+
+  // Input of the culling shader, matches CullData in cull.comp
+  struct CullData {
+    glm::vec4 bounds;
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t group;
+    uint32_t groupFirst;
+    uint32_t padding[3];
+  };
+
+  struct CullPushConstants {
+    glm::vec4 planes[6];
+    uint32_t drawCount;
+    uint32_t compact;
+    uint32_t commandsOffset;
+  };
+
+  // Only created once GPU culling is enabled
+  bool gpuCulling = false;
+  std::unique_ptr<ComputePipeline> cullPipeline;
+  std::unique_ptr<RingBuffer> cullDataRing;
+  // Every frame in flight's region holds one count per group, followed by
+  // the commands written by the culling pass
+  std::unique_ptr<StorageBuffer> culledBuffer;
+  VkDescriptorSet cullDescriptorSet{VK_NULL_HANDLE};
+  std::vector<CullData> cullData;
+  uint32_t cullDataOffset = 0;
+
+  // Whether cull was recorded for this frame's draws, and whether it
+  // compacted them
+  bool culled = false;
+  bool compact = false;
+
+  // Sorts the queued draws by texture and writes their model matrices and
+  // texture indices to the rings, once per frame
+  void prepare();
+
+  // Writes the draws' commands to the indirect ring, for frames without a
+  // culling pass
+  void writeCommands();
+
+  // Returns true if the culling pass can compact the visible draws
+  bool canCompact() const;
+
+  // Returns the offset of the current frame's region of culledBuffer
+  VkDeviceSize getCulledRegionOffset() const;
+
+  // Returns the material's descriptor set pointing at the texture, allocating
+  // and writing it the first time the texture is drawn. Bindless materials
+  // get the same set for every texture.
+  VkDescriptorSet getDescriptorSet(Texture *texture);
+
+  // Records the draws in [first, first + count) of the commands in buffer,
+  // starting at offset
+  void recordDraws(
+      VkCommandBuffer commandBuffer,
+      VkBuffer buffer,
+      VkDeviceSize offset,
+      uint32_t first,
+      uint32_t count);
+};
+} // namespace vkf
@@ -0,0 +1,245 @@
+#include "gpu_profiler.hpp"
+#include <stdexcept>
+
+using namespace vkf;
+
+void GpuProfiler::create(
+    VkDevice device,
+    const VkPhysicalDeviceProperties &properties,
+    uint32_t timestampValidBits,
+    uint32_t frameCount) {
+  this->device = device;
+
+  if (timestampValidBits == 0) {
+    return;
+  }
+
+  this->enabled = true;
+  this->timestampPeriod = properties.limits.timestampPeriod;
+  if (timestampValidBits < 64) {
+    this->timestampMask = (uint64_t(1) << timestampValidBits) - 1;
+  }
+
+  this->frames.resize(frameCount);
+
+  VkQueryPoolCreateInfo createInfo = {
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .queryType = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = MAX_GPU_PROFILER_QUERIES,
+      .pipelineStatistics = 0,
+  };
+
+  for (auto &frame : this->frames) {
+    if (vkCreateQueryPool(
+            this->device, &createInfo, nullptr, &frame.queryPool) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to create timestamp query pool");
+    }
+  }
+}
+
+void GpuProfiler::destroy() {
+  for (auto &frame : this->frames) {
+    if (frame.queryPool != VK_NULL_HANDLE) {
+      vkDestroyQueryPool(this->device, frame.queryPool, nullptr);
+      frame.queryPool = VK_NULL_HANDLE;
+    }
+  }
+
+  this->frames.clear();
+  this->enabled = false;
+}
+
+bool GpuProfiler::isEnabled() const {
+  return this->enabled;
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char *name) {
+  if (!this->enabled) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  Frame &frame = this->frames[this->currentFrame];
+  std::vector<int> &stack = this->openScopes[commandBuffer];
+
+  if (frame.queryCount + 2 > MAX_GPU_PROFILER_QUERIES) {
+    stack.push_back(-1);
+    return;
+  }
+
+  int parent = -1;
+  if (!stack.empty()) {
+    parent = stack.back();
+  } else if (commandBuffer != this->frameCommandBuffer) {
+    const std::vector<int> &frameStack =
+        this->openScopes[this->frameCommandBuffer];
+    if (!frameStack.empty()) {
+      parent = frameStack.back();
+    }
+  }
+
+  Scope scope = {
+      .name = name,
+      .parent = parent,
+      .beginQuery = frame.queryCount++,
+      // Reserved now, so the scope's queries don't depend on when it ends
+      .endQuery = frame.queryCount++,
+  };
+
+  stack.push_back(static_cast<int>(frame.scopes.size()));
+  frame.scopes.push_back(scope);
+
+  vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      frame.queryPool,
+      scope.beginQuery);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer) {
+  if (!this->enabled) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  Frame &frame = this->frames[this->currentFrame];
+  std::vector<int> &stack = this->openScopes[commandBuffer];
+
+  if (stack.empty()) {
+    throw std::runtime_error("Ended a GPU profiler scope that wasn't begun");
+  }
+
+  int index = stack.back();
+  stack.pop_back();
+
+  if (index == -1) {
+    return;
+  }
+
+  vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      frame.queryPool,
+      frame.scopes[index].endQuery);
+}
+
+const std::vector<GpuProfilerScope> &GpuProfiler::getFrameScopes() const {
+  return this->frameScopes;
+}
+
+const std::map<std::string, double> &GpuProfiler::getAverages() const {
+  return this->averages;
+}
+
+void GpuProfiler::beginFrame(
+    VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!this->enabled) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->currentFrame = frameIndex;
+    this->frameCommandBuffer = commandBuffer;
+    this->openScopes.clear();
+
+    Frame &frame = this->frames[frameIndex];
+    if (frame.pending) {
+      this->resolve(frame);
+    }
+
+    frame.queryCount = 0;
+    frame.scopes.clear();
+    frame.pending = true;
+
+    vkCmdResetQueryPool(
+        commandBuffer, frame.queryPool, 0, MAX_GPU_PROFILER_QUERIES);
+  }
+
+  this->beginScope(commandBuffer, "frame");
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+  if (!this->enabled) {
+    return;
+  }
+
+  this->endScope(commandBuffer);
+}
+
+void GpuProfiler::resolve(Frame &frame) {
+  frame.pending = false;
+
+  if (frame.queryCount == 0) {
+    return;
+  }
+
+  // The frame was already waited on, so the results are available
+  std::vector<uint64_t> timestamps(frame.queryCount);
+  if (vkGetQueryPoolResults(
+          this->device,
+          frame.queryPool,
+          0,
+          frame.queryCount,
+          timestamps.size() * sizeof(uint64_t),
+          timestamps.data(),
+          sizeof(uint64_t),
+          VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+
+  std::vector<std::vector<int>> children(frame.scopes.size() + 1);
+  for (size_t i = 0; i < frame.scopes.size(); i++) {
+    // Roots are stored as children of the last entry
+    int parent = frame.scopes[i].parent;
+    children[parent == -1 ? frame.scopes.size() : parent].push_back(i);
+  }
+
+  this->frameScopes.clear();
+  for (int root : children[frame.scopes.size()]) {
+    this->frameScopes.push_back(
+        this->buildScope(frame, timestamps, children, root, ""));
+  }
+}
+
+GpuProfilerScope GpuProfiler::buildScope(
+    const Frame &frame,
+    const std::vector<uint64_t> &timestamps,
+    const std::vector<std::vector<int>> &children,
+    int index,
+    const std::string &parentPath) {
+  const Scope &scope = frame.scopes[index];
+
+  uint64_t begin = timestamps[scope.beginQuery] & this->timestampMask;
+  uint64_t end = timestamps[scope.endQuery] & this->timestampMask;
+
+  GpuProfilerScope result;
+  result.name = scope.name;
+  result.milliseconds =
+      static_cast<double>((end - begin) & this->timestampMask) *
+      this->timestampPeriod / 1000000.0;
+
+  std::string path =
+      parentPath.empty() ? scope.name : parentPath + "/" + scope.name;
+
+  // A scope opened more than once in a frame adds a sample each time
+  double &average = this->averages[path];
+  uint32_t &samples = this->averageSamples[path];
+  if (samples < GPU_PROFILER_AVERAGE_FRAMES) {
+    samples++;
+  }
+  average += (result.milliseconds - average) / samples;
+
+  for (int child : children[index]) {
+    result.children.push_back(
+        this->buildScope(frame, timestamps, children, child, path));
+  }
+
+  return result;
+}
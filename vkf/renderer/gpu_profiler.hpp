@@ -0,0 +1,116 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+// Maximum number of timestamps written in a single frame, scopes opened past
+// this limit are ignored
+const uint32_t MAX_GPU_PROFILER_QUERIES = 1024;
+
+// Number of frames the rolling averages are taken over
+const uint32_t GPU_PROFILER_AVERAGE_FRAMES = 60;
+
+// Resolved GPU time of a scope and of the scopes opened inside it
+struct GpuProfilerScope {
+  std::string name;
+  double milliseconds = 0.0;
+  std::vector<GpuProfilerScope> children;
+};
+
+// Measures GPU time of named scopes with timestamp queries. Every frame in
+// flight has its own query pool, which is read back once the frame was
+// waited on.
+class GpuProfiler {
+public:
+  GpuProfiler(){};
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+  ~GpuProfiler(){};
+
+  // Creates the query pools. The profiler stays disabled if the queue
+  // family doesn't support timestamps.
+  void create(
+      VkDevice device,
+      const VkPhysicalDeviceProperties &properties,
+      uint32_t timestampValidBits,
+      uint32_t frameCount);
+  void destroy();
+
+  bool isEnabled() const;
+
+  // Writes the timestamp that opens a scope. Scopes nest per command buffer,
+  // scopes opened on a secondary command buffer are children of the scope
+  // currently open on the frame's primary command buffer.
+  void beginScope(VkCommandBuffer commandBuffer, const char *name);
+
+  // Writes the timestamp that closes the innermost scope open on
+  // commandBuffer
+  void endScope(VkCommandBuffer commandBuffer);
+
+  // Returns the scopes of the last resolved frame
+  const std::vector<GpuProfilerScope> &getFrameScopes() const;
+
+  // Returns the rolling averages in milliseconds, keyed by the scope's path,
+  // e.g. "frame/render pass"
+  const std::map<std::string, double> &getAverages() const;
+
+  // Reads the results of the frame previously recorded with this index and
+  // starts recording a new one. Must be called after the frame was waited
+  // on, outside of a render pass.
+  void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  // Closes the frame's root scope
+  void endFrame(VkCommandBuffer commandBuffer);
+
+private:
+  VkDevice device{VK_NULL_HANDLE};
+
+  bool enabled = false;
+  // Nanoseconds per timestamp tick
+  float timestampPeriod = 1.0f;
+  uint64_t timestampMask = UINT64_MAX;
+
+  struct Scope {
+    std::string name;
+    int parent;
+    uint32_t beginQuery;
+    uint32_t endQuery;
+  };
+
+  struct Frame {
+    VkQueryPool queryPool{VK_NULL_HANDLE};
+    uint32_t queryCount = 0;
+    std::vector<Scope> scopes;
+    // Whether the frame was recorded and its results weren't read yet
+    bool pending = false;
+  };
+
+  std::vector<Frame> frames;
+  uint32_t currentFrame = 0;
+  VkCommandBuffer frameCommandBuffer{VK_NULL_HANDLE};
+
+  // Indices of the open scopes of every command buffer, -1 for scopes that
+  // were dropped because the query pool was full
+  std::map<VkCommandBuffer, std::vector<int>> openScopes;
+
+  std::mutex mutex;
+
+  std::vector<GpuProfilerScope> frameScopes;
+  std::map<std::string, double> averages;
+  std::map<std::string, uint32_t> averageSamples;
+
+  // Reads back a frame's timestamps into frameScopes and the averages
+  void resolve(Frame &frame);
+
+  GpuProfilerScope buildScope(
+      const Frame &frame,
+      const std::vector<uint64_t> &timestamps,
+      const std::vector<std::vector<int>> &children,
+      int index,
+      const std::string &parentPath);
+};
+} // namespace vkf
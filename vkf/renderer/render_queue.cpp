@@ -0,0 +1,186 @@
+#include "render_queue.hpp"
+#include "../framework/framework.hpp"
+#include "../mesh/mesh.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace vkf;
+
+const uint32_t RENDER_KEY_DEPTH_SHIFT = 0;
+const uint32_t RENDER_KEY_VERTEX_BUFFER_SHIFT =
+    RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS;
+const uint32_t RENDER_KEY_DESCRIPTOR_SET_SHIFT =
+    RENDER_KEY_VERTEX_BUFFER_SHIFT + RENDER_KEY_VERTEX_BUFFER_BITS;
+const uint32_t RENDER_KEY_PIPELINE_SHIFT =
+    RENDER_KEY_DESCRIPTOR_SET_SHIFT + RENDER_KEY_DESCRIPTOR_SET_BITS;
+
+static_assert(
+    RENDER_KEY_PIPELINE_SHIFT + RENDER_KEY_PIPELINE_BITS == 64,
+    "Render key fields must fill 64 bits");
+
+RenderQueue::RenderQueue(Framework *framework) : framework(framework) {
+}
+
+void RenderQueue::submit(Mesh &mesh, const glm::mat4 &model, float depth) {
+  if (!mesh.isGeometryResident()) {
+    return;
+  }
+
+  Packet packet = {
+      .mesh = &mesh,
+      .pipeline = mesh.material->getPipeline(),
+      .descriptorSet = mesh.getDescriptorSet(),
+      .vertexBuffer = this->framework->getGeometryPool()->getVertexBuffer(),
+      .model = model,
+  };
+
+  uint64_t key =
+      hashHandle((uint64_t)packet.pipeline, RENDER_KEY_PIPELINE_BITS)
+          << RENDER_KEY_PIPELINE_SHIFT |
+      hashHandle((uint64_t)packet.descriptorSet, RENDER_KEY_DESCRIPTOR_SET_BITS)
+          << RENDER_KEY_DESCRIPTOR_SET_SHIFT |
+      hashHandle((uint64_t)packet.vertexBuffer, RENDER_KEY_VERTEX_BUFFER_BITS)
+          << RENDER_KEY_VERTEX_BUFFER_SHIFT |
+      quantizeDepth(depth) << RENDER_KEY_DEPTH_SHIFT;
+
+  this->keys.push_back(key);
+  this->order.push_back(static_cast<uint32_t>(this->packets.size()));
+  this->packets.push_back(packet);
+}
+
+void RenderQueue::draw(VkCommandBuffer commandBuffer) {
+  this->pipelineBindCount = 0;
+  this->descriptorSetBindCount = 0;
+  this->vertexBufferBindCount = 0;
+
+  this->sort();
+
+  GeometryPool *geometryPool = this->framework->getGeometryPool();
+  uint32_t cameraOffset = this->framework->getCameraOffset();
+
+  VkPipeline boundPipeline = VK_NULL_HANDLE;
+  VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+  VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+
+  for (uint32_t index : this->order) {
+    const Packet &packet = this->packets[index];
+    Material *material = packet.mesh->material;
+
+    if (packet.pipeline != boundPipeline) {
+      material->bindPipeline(commandBuffer);
+      boundPipeline = packet.pipeline;
+      this->pipelineBindCount++;
+
+      // Another material's layout may not be compatible with the set
+      boundDescriptorSet = VK_NULL_HANDLE;
+    }
+
+    if (packet.descriptorSet != boundDescriptorSet) {
+      vkCmdBindDescriptorSets(
+          commandBuffer,
+          VK_PIPELINE_BIND_POINT_GRAPHICS,
+          material->pipelineLayout,
+          0,
+          1,
+          &packet.descriptorSet,
+          1,
+          &cameraOffset);
+      boundDescriptorSet = packet.descriptorSet;
+      this->descriptorSetBindCount++;
+    }
+
+    // Vertex buffer bindings don't depend on the pipeline, so they're kept
+    // across pipeline changes
+    if (packet.vertexBuffer != boundVertexBuffer) {
+      geometryPool->bind(commandBuffer);
+      boundVertexBuffer = packet.vertexBuffer;
+      this->vertexBufferBindCount++;
+    }
+
+    packet.mesh->pushConstants(commandBuffer, packet.model);
+
+    GeometryRange range = geometryPool->getRange(packet.mesh->getGeometry());
+    vkCmdDrawIndexed(
+        commandBuffer,
+        range.indexCount,
+        1,
+        range.firstIndex,
+        static_cast<int32_t>(range.vertexOffset),
+        0);
+  }
+
+  this->packets.clear();
+  this->keys.clear();
+  this->order.clear();
+}
+
+uint32_t RenderQueue::size() const {
+  return static_cast<uint32_t>(this->packets.size());
+}
+
+uint32_t RenderQueue::getPipelineBindCount() const {
+  return this->pipelineBindCount;
+}
+
+uint32_t RenderQueue::getDescriptorSetBindCount() const {
+  return this->descriptorSetBindCount;
+}
+
+uint32_t RenderQueue::getVertexBufferBindCount() const {
+  return this->vertexBufferBindCount;
+}
+
+void RenderQueue::sort() {
+  size_t count = this->keys.size();
+  if (count < 2) {
+    return;
+  }
+
+  this->scratchKeys.resize(count);
+  this->scratchOrder.resize(count);
+
+  // Least significant byte first, every pass is stable so the order of the
+  // previous passes is kept among equal bytes
+  for (uint32_t shift = 0; shift < 64; shift += 8) {
+    std::array<size_t, 256> offsets{};
+    for (uint64_t key : this->keys) {
+      offsets[(key >> shift) & 0xFF]++;
+    }
+
+    if (offsets[(this->keys[0] >> shift) & 0xFF] == count) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (size_t &bucket : offsets) {
+      size_t bucketCount = bucket;
+      bucket = offset;
+      offset += bucketCount;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      size_t destination = offsets[(this->keys[i] >> shift) & 0xFF]++;
+      this->scratchKeys[destination] = this->keys[i];
+      this->scratchOrder[destination] = this->order[i];
+    }
+
+    this->keys.swap(this->scratchKeys);
+    this->order.swap(this->scratchOrder);
+  }
+}
+
+uint64_t RenderQueue::hashHandle(uint64_t handle, uint32_t bits) {
+  // Fibonacci hashing, the top bits of the product depend on every bit of
+  // the handle
+  return (handle * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+uint64_t RenderQueue::quantizeDepth(float depth) {
+  // Draws behind the camera are sorted as if they were at it
+  depth = std::max(depth, 0.0f);
+
+  uint32_t bits;
+  memcpy(&bits, &depth, sizeof(bits));
+  return bits >> (32 - RENDER_KEY_DEPTH_BITS);
+}
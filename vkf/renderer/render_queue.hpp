@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+class Mesh;
+
+// Bits of every field of a render queue sort key, from the most significant.
+// Fields are hashes of the state's handles, so draws sharing state end up
+// next to each other, while the recorder compares the handles themselves.
+const uint32_t RENDER_KEY_PIPELINE_BITS = 12;
+const uint32_t RENDER_KEY_DESCRIPTOR_SET_BITS = 20;
+const uint32_t RENDER_KEY_VERTEX_BUFFER_BITS = 8;
+const uint32_t RENDER_KEY_DEPTH_BITS = 24;
+
+// Collects the meshes drawn in a frame as draw packets and records them
+// sorted by a 64-bit key of pipeline, descriptor set, vertex buffer and
+// depth. The keys are sorted with a radix sort, and pipelines, descriptor
+// sets and vertex buffers are only bound when they change between packets.
+class RenderQueue {
+public:
+  RenderQueue(Framework *framework);
+  RenderQueue(const RenderQueue &) = delete;
+  RenderQueue &operator=(const RenderQueue &) = delete;
+  ~RenderQueue(){};
+
+  // Queues a draw of the mesh with its material. depth is the draw's
+  // distance from the camera, draws sharing all their state are recorded
+  // front to back. Skipped until the mesh's geometry is uploaded.
+  void submit(Mesh &mesh, const glm::mat4 &model, float depth = 0.0f);
+
+  // Sorts and records every queued draw and clears them. Must be called
+  // inside the render pass, after the framework's camera was set.
+  void draw(VkCommandBuffer commandBuffer);
+
+  // Returns the number of queued draws
+  uint32_t size() const;
+
+  // Binds recorded by the last draw, every bind skipped is a draw that
+  // shared the state of the previous one
+  uint32_t getPipelineBindCount() const;
+  uint32_t getDescriptorSetBindCount() const;
+  uint32_t getVertexBufferBindCount() const;
+
+private:
+  Framework *framework{nullptr};
+
+  struct Packet {
+    Mesh *mesh;
+    VkPipeline pipeline;
+    VkDescriptorSet descriptorSet;
+    VkBuffer vertexBuffer;
+    glm::mat4 model;
+  };
+
+  std::vector<Packet> packets;
+
+  // Sort key and packet index of every draw, plus the scratch space of the
+  // radix sort. Reused every frame, to avoid reallocating them.
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> order;
+  std::vector<uint64_t> scratchKeys;
+  std::vector<uint32_t> scratchOrder;
+
+  uint32_t pipelineBindCount = 0;
+  uint32_t descriptorSetBindCount = 0;
+  uint32_t vertexBufferBindCount = 0;
+
+  // Sorts keys and order together by key, 8 bits per pass. Passes over
+  // bytes that are the same in every key are skipped.
+  void sort();
+
+  // Returns bits bits of the handle, scattered so nearby handles get
+  // unrelated values
+  static uint64_t hashHandle(uint64_t handle, uint32_t bits);
+
+  // Returns the top bits of the depth, which keep the order of non-negative
+  // floats
+  static uint64_t quantizeDepth(float depth);
+};
+} // namespace vkf
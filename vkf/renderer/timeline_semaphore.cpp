@@ -0,0 +1,240 @@
+#include "timeline_semaphore.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace vkf;
+
+void TimelineSemaphore::create(VkDevice device, bool native) {
+  this->device = device;
+  this->native = native;
+  this->completedValue = 0;
+  this->submittedValue = 0;
+
+  if (!this->native) {
+    return;
+  }
+
+  this->getSemaphoreCounterValue =
+      reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+          vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+  this->waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+      vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+
+  if (this->getSemaphoreCounterValue == nullptr ||
+      this->waitSemaphores == nullptr) {
+    this->native = false;
+    return;
+  }
+
+  VkSemaphoreTypeCreateInfoKHR semaphoreTypeCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+      .pNext = nullptr,
+      .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+      .initialValue = 0,
+  };
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+      .pNext = &semaphoreTypeCreateInfo,
+      .flags = 0,
+  };
+
+  if (vkCreateSemaphore(
+          device, &semaphoreCreateInfo, nullptr, &this->semaphore) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create timeline semaphore");
+  }
+}
+
+void TimelineSemaphore::destroy() {
+  if (this->device == VK_NULL_HANDLE) {
+    return;
+  }
+
+  if (this->semaphore != VK_NULL_HANDLE) {
+    vkDestroySemaphore(this->device, this->semaphore, nullptr);
+    this->semaphore = VK_NULL_HANDLE;
+  }
+
+  for (const auto &signal : this->pendingSignals) {
+    vkDestroyFence(this->device, signal.fence, nullptr);
+  }
+  this->pendingSignals.clear();
+
+  for (VkFence fence : this->freeFences) {
+    vkDestroyFence(this->device, fence, nullptr);
+  }
+  this->freeFences.clear();
+
+  this->device = VK_NULL_HANDLE;
+}
+
+bool TimelineSemaphore::isNative() const {
+  return this->native;
+}
+
+VkResult TimelineSemaphore::submit(
+    VkQueue queue, const VkSubmitInfo &submitInfo, uint64_t value) {
+  if (this->native) {
+    std::vector<VkSemaphore> signalSemaphores(
+        submitInfo.pSignalSemaphores,
+        submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    signalSemaphores.push_back(this->semaphore);
+
+    // Values of binary semaphores are ignored
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+    signalValues.back() = value;
+
+    VkTimelineSemaphoreSubmitInfoKHR timelineSubmitInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = submitInfo.pNext,
+        .waitSemaphoreValueCount = 0,
+        .pWaitSemaphoreValues = nullptr,
+        .signalSemaphoreValueCount =
+            static_cast<uint32_t>(signalValues.size()),
+        .pSignalSemaphoreValues = signalValues.data(),
+    };
+
+    VkSubmitInfo timelineSubmit = submitInfo;
+    timelineSubmit.pNext = &timelineSubmitInfo;
+    timelineSubmit.signalSemaphoreCount =
+        static_cast<uint32_t>(signalSemaphores.size());
+    timelineSubmit.pSignalSemaphores = signalSemaphores.data();
+
+    VkResult result =
+        vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE);
+    if (result == VK_SUCCESS) {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->submittedValue = std::max(this->submittedValue, value);
+    }
+
+    return result;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  VkFence fence;
+  if (!this->freeFences.empty()) {
+    fence = this->freeFences.back();
+    this->freeFences.pop_back();
+  } else {
+    VkFenceCreateInfo fenceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+    };
+
+    if (vkCreateFence(this->device, &fenceCreateInfo, nullptr, &fence) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to create timeline fence");
+    }
+  }
+
+  VkResult result = vkQueueSubmit(queue, 1, &submitInfo, fence);
+  if (result != VK_SUCCESS) {
+    this->freeFences.push_back(fence);
+    return result;
+  }
+
+  this->pendingSignals.push_back({
+      .value = value,
+      .fence = fence,
+  });
+  this->submittedValue = std::max(this->submittedValue, value);
+
+  return VK_SUCCESS;
+}
+
+uint64_t TimelineSemaphore::getCompletedValue() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->poll();
+  return this->completedValue;
+}
+
+bool TimelineSemaphore::isComplete(uint64_t value) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (value <= this->completedValue) {
+    return true;
+  }
+
+  this->poll();
+  return value <= this->completedValue;
+}
+
+void TimelineSemaphore::wait(uint64_t value) {
+  if (this->isComplete(value)) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (value > this->submittedValue) {
+      throw std::runtime_error("Waited for a timeline value never submitted");
+    }
+  }
+
+  if (this->native) {
+    VkSemaphoreWaitInfoKHR waitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+        .pNext = nullptr,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &this->semaphore,
+        .pValues = &value,
+    };
+
+    if (this->waitSemaphores(this->device, &waitInfo, UINT64_MAX) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Waiting for timeline semaphore took too long");
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->completedValue = std::max(this->completedValue, value);
+    return;
+  }
+
+  // Fences are only reset by poll, so the lock is held while waiting
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  for (const auto &signal : this->pendingSignals) {
+    if (signal.value < value) {
+      continue;
+    }
+
+    if (vkWaitForFences(this->device, 1, &signal.fence, VK_TRUE, UINT64_MAX) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Waiting for timeline fence took too long");
+    }
+
+    this->poll();
+    return;
+  }
+}
+
+void TimelineSemaphore::poll() {
+  if (this->native) {
+    uint64_t value;
+    if (this->getSemaphoreCounterValue(this->device, this->semaphore, &value) ==
+        VK_SUCCESS) {
+      this->completedValue = std::max(this->completedValue, value);
+    }
+    return;
+  }
+
+  // Submissions finish in order, so the first unsignaled fence ends the
+  // completed range
+  while (!this->pendingSignals.empty()) {
+    const PendingSignal &signal = this->pendingSignals.front();
+    if (vkGetFenceStatus(this->device, signal.fence) != VK_SUCCESS) {
+      break;
+    }
+
+    this->completedValue = std::max(this->completedValue, signal.value);
+
+    vkResetFences(this->device, 1, &signal.fence);
+    this->freeFences.push_back(signal.fence);
+    this->pendingSignals.pop_front();
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+
+// Tracks the completion of GPU work with a monotonically increasing value,
+// which every submission signals once it finishes executing. Any value up to
+// the last one signaled can be checked or waited on without keeping a fence
+// per submission around.
+//
+// Backed by a VK_KHR_timeline_semaphore semaphore if the device supports
+// it, otherwise every submission signals a fence from a recycled pool and
+// the value is derived from the fences in submission order.
+class TimelineSemaphore {
+public:
+  TimelineSemaphore(){};
+  TimelineSemaphore(const TimelineSemaphore &) = delete;
+  TimelineSemaphore &operator=(const TimelineSemaphore &) = delete;
+  ~TimelineSemaphore(){};
+
+  // Creates the semaphore, starting at 0. native picks the timeline
+  // semaphore over fences, the extension must be enabled on the device.
+  void create(VkDevice device, bool native);
+  void destroy();
+
+  // Returns true if a timeline semaphore is used instead of fences
+  bool isNative() const;
+
+  // Submits a batch that signals value once it finishes, along with the
+  // batch's own signal semaphores. Values must be submitted in increasing
+  // order, to queues that execute them in that order.
+  VkResult
+  submit(VkQueue queue, const VkSubmitInfo &submitInfo, uint64_t value);
+
+  // Returns the highest value known to be signaled
+  uint64_t getCompletedValue();
+
+  // Returns true once value was signaled, 0 always was
+  bool isComplete(uint64_t value);
+
+  // Blocks until value was signaled. Throws if value was never submitted.
+  void wait(uint64_t value);
+
+private:
+  VkDevice device{VK_NULL_HANDLE};
+
+  bool native = false;
+  VkSemaphore semaphore{VK_NULL_HANDLE};
+  PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue{nullptr};
+  PFN_vkWaitSemaphoresKHR waitSemaphores{nullptr};
+
+  // Highest value seen signaled, values up to it aren't queried again
+  uint64_t completedValue = 0;
+
+  // Highest value submitted, waiting for anything above it would never
+  // return
+  uint64_t submittedValue = 0;
+
+  struct PendingSignal {
+    uint64_t value;
+    VkFence fence;
+  };
+
+  // Without timeline semaphores, the fences of submissions that weren't seen
+  // finished yet, in submission order
+  std::deque<PendingSignal> pendingSignals;
+  std::vector<VkFence> freeFences;
+
+  // Completion is checked from any thread, e.g. by deferred frees
+  std::mutex mutex;
+
+  // Reads the semaphore's value, or retires the pending fences that were
+  // signaled. Expects the mutex to be locked.
+  void poll();
+};
+} // namespace vkf
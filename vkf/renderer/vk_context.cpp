@@ -1,9 +1,15 @@
 #include "vk_context.hpp"
+#include "../io/mapped_file.hpp"
 #include "../window/window.hpp"
+#include <algorithm>
 #include <cstring>
+#include <fstream>
 
 using namespace vkf;
 
+// "VKPC" in little endian
+const uint32_t PIPELINE_CACHE_MAGIC = 0x43504b56;
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     VkDebugReportFlagsEXT flags,
     VkDebugReportObjectTypeEXT objType,
@@ -19,19 +25,28 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
   return VK_FALSE;
 }
 
-VkContext::VkContext(Window *window) : window(window) {
+VkContext::VkContext(Window *window)
+    : window(window), headless(window->isHeadless()) {
   this->createInstance(window->getVulkanExtensions());
 #ifndef NDEBUG
   this->setupDebugCallback();
 #endif
-  window->createVulkanSurface(this->instance, &this->surface);
+  if (!this->headless) {
+    window->createVulkanSurface(this->instance, &this->surface);
+  }
   this->createDevice();
   this->getDeviceQueues();
   this->setupMemoryAllocator();
+  this->createPipelineCache();
+  this->createProfiler();
 
   this->createSyncObjects();
 
-  this->createSwapchain(window->getWidth(), window->getHeight());
+  if (this->headless) {
+    this->createOffscreenImages(window->getWidth(), window->getHeight());
+  } else {
+    this->createSwapchain(window->getWidth(), window->getHeight());
+  }
   this->createSwapchainImageViews();
 
   this->createGraphicsCommandPool();
@@ -42,6 +57,8 @@ VkContext::VkContext(Window *window) : window(window) {
 
   this->createRenderPass();
 
+  this->createFramebuffers();
+
   this->window->addHandler(this);
 }
 
@@ -51,6 +68,11 @@ VkContext::~VkContext() {
 
     this->destroyResizables();
 
+    if (this->renderPass != VK_NULL_HANDLE) {
+      vkDestroyRenderPass(this->device, this->renderPass, nullptr);
+      this->renderPass = VK_NULL_HANDLE;
+    }
+
     if (this->transientCommandPool != VK_NULL_HANDLE) {
       vkDestroyCommandPool(this->device, this->transientCommandPool, nullptr);
       this->transientCommandPool = VK_NULL_HANDLE;
@@ -62,12 +84,9 @@ VkContext::~VkContext() {
     }
 
     for (const auto &resources : this->frameResources) {
-      if (resources.framebuffer != VK_NULL_HANDLE) {
-        vkDestroyFramebuffer(this->device, resources.framebuffer, nullptr);
-      }
-
-      if (resources.fence != VK_NULL_HANDLE) {
-        vkDestroyFence(this->device, resources.fence, nullptr);
+      // Also frees the secondary command buffers
+      for (const auto &commandPool : resources.secondaryCommandPools) {
+        vkDestroyCommandPool(this->device, commandPool, nullptr);
       }
 
       if (resources.renderingFinishedSemaphore != VK_NULL_HANDLE) {
@@ -87,10 +106,20 @@ VkContext::~VkContext() {
       }
     }
 
+    this->destroyOffscreenImages();
+
     if (this->swapchain != VK_NULL_HANDLE) {
       vkDestroySwapchainKHR(this->device, this->swapchain, nullptr);
     }
 
+    this->profiler.destroy();
+    this->frameTimeline.destroy();
+
+    if (this->pipelineCache != VK_NULL_HANDLE) {
+      this->savePipelineCache();
+      vkDestroyPipelineCache(this->device, this->pipelineCache, nullptr);
+    }
+
     if (this->allocator != VK_NULL_HANDLE) {
       vmaDestroyAllocator(this->allocator);
     }
@@ -121,14 +150,145 @@ VkDevice VkContext::getDevice() {
   return this->device;
 }
 
+VkPhysicalDevice VkContext::getPhysicalDevice() {
+  return this->physicalDevice;
+}
+
 VkRenderPass VkContext::getRenderPass() {
   return this->renderPass;
 }
 
+uint32_t VkContext::getRenderPassVersion() {
+  return this->renderPassVersion;
+}
+
 VkQueue VkContext::getGraphicsQueue() {
   return this->graphicsQueue;
 }
 
+VkPipelineCache VkContext::getPipelineCache() {
+  return this->pipelineCache;
+}
+
+uint32_t VkContext::getGraphicsQueueFamilyIndex() const {
+  return this->graphicsQueueFamilyIndex;
+}
+
+VkQueue VkContext::getTransferQueue() {
+  return this->transferQueue;
+}
+
+uint32_t VkContext::getTransferQueueFamilyIndex() const {
+  return this->transferQueueFamilyIndex;
+}
+
+const VkPhysicalDeviceProperties &
+VkContext::getPhysicalDeviceProperties() const {
+  return this->physicalDeviceProperties;
+}
+
+const VkPhysicalDeviceFeatures &VkContext::getEnabledFeatures() const {
+  return this->enabledFeatures;
+}
+
+bool VkContext::isDeviceExtensionEnabled(const char *name) const {
+  for (const char *extension : this->enabledOptionalExtensions) {
+    if (strcmp(extension, name) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool VkContext::isInstanceExtensionEnabled(const char *name) const {
+  for (const char *extension : this->enabledOptionalInstanceExtensions) {
+    if (strcmp(extension, name) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool VkContext::isBindlessSupported() const {
+  return this->bindlessSupported;
+}
+
+bool VkContext::isTimelineSemaphoreSupported() const {
+  return this->timelineSemaphoreSupported;
+}
+
+uint32_t VkContext::getMaxBindlessTextures() const {
+  return this->maxBindlessTextures;
+}
+
+PFN_vkCmdDrawIndexedIndirectCountKHR
+VkContext::getDrawIndexedIndirectCount() const {
+  return this->drawIndexedIndirectCount;
+}
+
+float VkContext::getMaxSamplerAnisotropy() const {
+  if (!this->enabledFeatures.samplerAnisotropy) {
+    return 1.0f;
+  }
+
+  return std::min(
+      this->physicalDeviceProperties.limits.maxSamplerAnisotropy,
+      MAX_SAMPLER_ANISOTROPY);
+}
+
+int VkContext::getCurrentFrame() const {
+  return this->currentFrame;
+}
+
+uint64_t VkContext::getFrameNumber() const {
+  return this->frameNumber;
+}
+
+bool VkContext::isFrameComplete(uint64_t frameNumber) {
+  return this->frameTimeline.isComplete(frameNumber + 1);
+}
+
+void VkContext::waitForCurrentFrame() {
+  // The frame in flight was last used MAX_FRAMES_IN_FLIGHT frames ago.
+  // Waiting for a value that was already seen signaled returns immediately.
+  if (this->frameNumber >= MAX_FRAMES_IN_FLIGHT) {
+    this->frameTimeline.wait(this->frameNumber + 1 - MAX_FRAMES_IN_FLIGHT);
+  }
+}
+
+bool VkContext::isHeadless() const {
+  return this->headless;
+}
+
+void VkContext::setReadbackEnabled(bool enabled) {
+  this->readbackEnabled = enabled;
+}
+
+void VkContext::readPixels(std::vector<uint8_t> &pixels) {
+  if (!this->headless || !this->readbackEnabled) {
+    throw std::runtime_error(
+        "Pixels can only be read in headless mode with readback enabled");
+  }
+
+  FrameResources &resources =
+      this->frameResources
+          [(this->currentFrame + MAX_FRAMES_IN_FLIGHT - 1) %
+           MAX_FRAMES_IN_FLIGHT];
+
+  // The last presented frame signals the current frame number
+  this->frameTimeline.wait(this->frameNumber);
+
+  pixels.resize(
+      this->swapchainExtent.width * this->swapchainExtent.height * 4);
+  memcpy(pixels.data(), resources.readbackData, pixels.size());
+}
+
+uint64_t VkContext::getFramebufferCreationCount() const {
+  return this->framebufferCreationCount;
+}
+
 void VkContext::useTransientCommandBuffer(
     std::function<void(VkCommandBuffer)> function) {
   VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
@@ -188,10 +348,19 @@ VkContext::getRequiredExtensions(std::vector<const char *> sdlExtensions) {
   return extensions;
 }
 
+std::vector<const char *> VkContext::getRequiredDeviceExtensions() {
+  if (this->headless) {
+    return {};
+  }
+
+  return REQUIRED_DEVICE_EXTENSIONS;
+}
+
 bool VkContext::checkPhysicalDeviceProperties(
     VkPhysicalDevice physicalDevice,
     uint32_t *selectedGraphicsQueueFamilyIndex,
-    uint32_t *selectedPresentQueueFamilyIndex) {
+    uint32_t *selectedPresentQueueFamilyIndex,
+    uint32_t *selectedTransferQueueFamilyIndex) {
   uint32_t extensionCount = 0;
   if (vkEnumerateDeviceExtensionProperties(
           physicalDevice, nullptr, &extensionCount, nullptr) != VK_SUCCESS ||
@@ -212,7 +381,7 @@ bool VkContext::checkPhysicalDeviceProperties(
     return false;
   }
 
-  for (const auto &requiredExtension : REQUIRED_DEVICE_EXTENSIONS) {
+  for (const auto &requiredExtension : this->getRequiredDeviceExtensions()) {
     bool found = false;
     for (const auto &extension : availableExtensions) {
       if (strcmp(requiredExtension, extension.extensionName) == 0) {
@@ -263,9 +432,19 @@ bool VkContext::checkPhysicalDeviceProperties(
   uint32_t graphicsQueueFamilyIndex = UINT32_MAX;
   uint32_t presentQueueFamilyIndex = UINT32_MAX;
 
+  // Falls back to the graphics queue family when it's UINT32_MAX
+  *selectedTransferQueueFamilyIndex =
+      this->getTransferQueueFamily(queueFamilyProperties);
+
   for (uint32_t i = 0; i < queueFamilyCount; i++) {
-    vkGetPhysicalDeviceSurfaceSupportKHR(
-        physicalDevice, i, this->surface, &queuePresentSupport[i]);
+    if (this->headless) {
+      // Nothing is presented, so the graphics queue doubles as the present
+      // queue
+      queuePresentSupport[i] = VK_TRUE;
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(
+          physicalDevice, i, this->surface, &queuePresentSupport[i]);
+    }
 
     if (queueFamilyProperties[i].queueCount > 0 &&
         queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
@@ -276,6 +455,9 @@ bool VkContext::checkPhysicalDeviceProperties(
       if (queuePresentSupport[i]) {
         *selectedGraphicsQueueFamilyIndex = i;
         *selectedPresentQueueFamilyIndex = i;
+        if (*selectedTransferQueueFamilyIndex == UINT32_MAX) {
+          *selectedTransferQueueFamilyIndex = i;
+        }
         return true;
       }
     }
@@ -298,10 +480,38 @@ bool VkContext::checkPhysicalDeviceProperties(
 
   *selectedGraphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
   *selectedPresentQueueFamilyIndex = presentQueueFamilyIndex;
+  if (*selectedTransferQueueFamilyIndex == UINT32_MAX) {
+    *selectedTransferQueueFamilyIndex = graphicsQueueFamilyIndex;
+  }
 
   return true;
 }
 
+uint32_t VkContext::getTransferQueueFamily(
+    const std::vector<VkQueueFamilyProperties> &queueFamilyProperties) {
+  uint32_t transferQueueFamilyIndex = UINT32_MAX;
+
+  for (uint32_t i = 0; i < queueFamilyProperties.size(); i++) {
+    VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+
+    if (queueFamilyProperties[i].queueCount == 0 ||
+        !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+
+    // Transfer-only families usually map to dedicated DMA engines
+    if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+      return i;
+    }
+
+    if (transferQueueFamilyIndex == UINT32_MAX) {
+      transferQueueFamilyIndex = i;
+    }
+  }
+
+  return transferQueueFamilyIndex;
+}
+
 uint32_t VkContext::getSwapchainNumImages(
     const VkSurfaceCapabilitiesKHR &surfaceCapabilities) {
   uint32_t imageCount = surfaceCapabilities.minImageCount + 1;
@@ -442,7 +652,11 @@ VkPresentModeKHR VkContext::getSwapchainPresentMode(
 }
 
 VkShaderModule VkContext::createShaderModule(std::vector<char> code) {
-  if (code.size() == 0) {
+  return this->createShaderModule(code.data(), code.size());
+}
+
+VkShaderModule VkContext::createShaderModule(const void *code, size_t size) {
+  if (size == 0) {
     throw std::runtime_error("Shader code loaded with size 0");
   }
 
@@ -450,9 +664,8 @@ VkShaderModule VkContext::createShaderModule(std::vector<char> code) {
   shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
   shaderModuleCreateInfo.pNext = nullptr;
   shaderModuleCreateInfo.flags = 0;
-  shaderModuleCreateInfo.codeSize = code.size();
-  shaderModuleCreateInfo.pCode =
-      reinterpret_cast<const uint32_t *>(code.data());
+  shaderModuleCreateInfo.codeSize = size;
+  shaderModuleCreateInfo.pCode = static_cast<const uint32_t *>(code);
 
   VkShaderModule shaderModule;
   if (vkCreateShaderModule(
@@ -464,6 +677,12 @@ VkShaderModule VkContext::createShaderModule(std::vector<char> code) {
   return shaderModule;
 }
 
+VkShaderModule VkContext::loadShaderModule(const char *path) {
+  // The mapping is page aligned, as SPIR-V words need to be
+  MappedFile file(path);
+  return this->createShaderModule(file.getData(), file.getSize());
+}
+
 void VkContext::createInstance(std::vector<const char *> sdlExtensions) {
 #ifndef NDEBUG
   if (!checkValidationLayerSupport()) {
@@ -498,6 +717,23 @@ void VkContext::createInstance(std::vector<const char *> sdlExtensions) {
 #endif
 
   auto extensions = this->getRequiredExtensions(sdlExtensions);
+
+  uint32_t extensionCount = 0;
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateInstanceExtensionProperties(
+      nullptr, &extensionCount, availableExtensions.data());
+
+  for (const auto &optionalExtension : OPTIONAL_INSTANCE_EXTENSIONS) {
+    for (const auto &extension : availableExtensions) {
+      if (strcmp(optionalExtension, extension.extensionName) == 0) {
+        this->enabledOptionalInstanceExtensions.push_back(optionalExtension);
+        extensions.push_back(optionalExtension);
+        break;
+      }
+    }
+  }
+
   createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
   createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -539,11 +775,13 @@ void VkContext::createDevice() {
 
   uint32_t selectedGraphicsQueueFamilyIndex = UINT32_MAX;
   uint32_t selectedPresentQueueFamilyIndex = UINT32_MAX;
+  uint32_t selectedTransferQueueFamilyIndex = UINT32_MAX;
   for (uint32_t i = 0; i < deviceCount; i++) {
     if (checkPhysicalDeviceProperties(
             physicalDevices[i],
             &selectedGraphicsQueueFamilyIndex,
-            &selectedPresentQueueFamilyIndex)) {
+            &selectedPresentQueueFamilyIndex,
+            &selectedTransferQueueFamilyIndex)) {
       physicalDevice = physicalDevices[i];
       break;
     }
@@ -577,6 +815,18 @@ void VkContext::createDevice() {
     });
   }
 
+  if (selectedTransferQueueFamilyIndex != selectedGraphicsQueueFamilyIndex &&
+      selectedTransferQueueFamilyIndex != selectedPresentQueueFamilyIndex) {
+    queueCreateInfos.push_back({
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .queueFamilyIndex = selectedTransferQueueFamilyIndex,
+        .queueCount = static_cast<uint32_t>(queuePriorities.size()),
+        .pQueuePriorities = queuePriorities.data(),
+    });
+  }
+
   VkDeviceCreateInfo deviceCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
       .pNext = nullptr,
@@ -594,11 +844,60 @@ void VkContext::createDevice() {
   deviceCreateInfo.ppEnabledLayerNames = REQUIRED_VALIDATION_LAYERS.data();
 #endif
 
+  std::vector<const char *> deviceExtensions =
+      this->getRequiredDeviceExtensions();
+
+  uint32_t extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(
+      this->physicalDevice, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      this->physicalDevice,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  bool properties2Enabled = this->isInstanceExtensionEnabled(
+      VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
+  for (const auto &optionalExtension : OPTIONAL_DEVICE_EXTENSIONS) {
+    if (!properties2Enabled &&
+        std::find_if(
+            PROPERTIES_2_DEVICE_EXTENSIONS.begin(),
+            PROPERTIES_2_DEVICE_EXTENSIONS.end(),
+            [&](const char *name) {
+              return strcmp(name, optionalExtension) == 0;
+            }) != PROPERTIES_2_DEVICE_EXTENSIONS.end()) {
+      continue;
+    }
+
+    for (const auto &extension : availableExtensions) {
+      if (strcmp(optionalExtension, extension.extensionName) == 0) {
+        this->enabledOptionalExtensions.push_back(optionalExtension);
+        deviceExtensions.push_back(optionalExtension);
+        break;
+      }
+    }
+  }
+
   deviceCreateInfo.enabledExtensionCount =
-      static_cast<uint32_t>(REQUIRED_DEVICE_EXTENSIONS.size());
-  deviceCreateInfo.ppEnabledExtensionNames = REQUIRED_DEVICE_EXTENSIONS.data();
+      static_cast<uint32_t>(deviceExtensions.size());
+  deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(this->physicalDevice, &supportedFeatures);
+
+  this->enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+  this->enabledFeatures.textureCompressionBC =
+      supportedFeatures.textureCompressionBC;
+  // Used by the batch renderer to issue a whole batch with one call
+  this->enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  this->enabledFeatures.drawIndirectFirstInstance =
+      supportedFeatures.drawIndirectFirstInstance;
 
-  deviceCreateInfo.pEnabledFeatures = nullptr;
+  deviceCreateInfo.pEnabledFeatures = &this->enabledFeatures;
+
+  this->chainExtensionFeatures(deviceCreateInfo);
 
   if (vkCreateDevice(
           this->physicalDevice, &deviceCreateInfo, nullptr, &this->device) !=
@@ -606,8 +905,132 @@ void VkContext::createDevice() {
     throw std::runtime_error("Failed to create logical device");
   }
 
+  if (this->isDeviceExtensionEnabled(
+          VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+    this->drawIndexedIndirectCount =
+        reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(
+                this->device, "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+
+  vkGetPhysicalDeviceProperties(
+      this->physicalDevice, &this->physicalDeviceProperties);
+
+  this->queryExtensionProperties();
+
   this->graphicsQueueFamilyIndex = selectedGraphicsQueueFamilyIndex;
   this->presentQueueFamilyIndex = selectedPresentQueueFamilyIndex;
+  this->transferQueueFamilyIndex = selectedTransferQueueFamilyIndex;
+}
+
+void VkContext::chainExtensionFeatures(VkDeviceCreateInfo &deviceCreateInfo) {
+  if (!this->isInstanceExtensionEnabled(
+          VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+    return;
+  }
+
+  auto getPhysicalDeviceFeatures2 =
+      reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+          vkGetInstanceProcAddr(
+              this->instance, "vkGetPhysicalDeviceFeatures2KHR"));
+  if (getPhysicalDeviceFeatures2 == nullptr) {
+    return;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT supportedDescriptorIndexing = {
+      .sType =
+          VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+      .pNext = nullptr,
+  };
+
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR supportedTimelineSemaphore = {
+      .sType =
+          VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+      .pNext = nullptr,
+  };
+
+  VkPhysicalDeviceFeatures2KHR supportedFeatures = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+      .pNext = nullptr,
+  };
+
+  // Only extensions that were enabled are queried
+  if (this->isDeviceExtensionEnabled(
+          VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+      this->isDeviceExtensionEnabled(VK_KHR_MAINTENANCE3_EXTENSION_NAME)) {
+    supportedDescriptorIndexing.pNext = supportedFeatures.pNext;
+    supportedFeatures.pNext = &supportedDescriptorIndexing;
+  }
+
+  if (this->isDeviceExtensionEnabled(
+          VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+    supportedTimelineSemaphore.pNext = supportedFeatures.pNext;
+    supportedFeatures.pNext = &supportedTimelineSemaphore;
+  }
+
+  getPhysicalDeviceFeatures2(this->physicalDevice, &supportedFeatures);
+
+  // Used by the texture table, only enabled if they all are supported
+  if (supportedDescriptorIndexing.shaderSampledImageArrayNonUniformIndexing &&
+      supportedDescriptorIndexing
+          .descriptorBindingSampledImageUpdateAfterBind &&
+      supportedDescriptorIndexing.descriptorBindingPartiallyBound &&
+      supportedDescriptorIndexing.runtimeDescriptorArray) {
+    this->descriptorIndexingFeatures
+        .shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    this->descriptorIndexingFeatures
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    this->descriptorIndexingFeatures.descriptorBindingPartiallyBound =
+        VK_TRUE;
+    this->descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+
+    this->descriptorIndexingFeatures.pNext =
+        const_cast<void *>(deviceCreateInfo.pNext);
+    deviceCreateInfo.pNext = &this->descriptorIndexingFeatures;
+    this->bindlessSupported = true;
+  }
+
+  // Used to track the completion of frames and uploads
+  if (supportedTimelineSemaphore.timelineSemaphore) {
+    this->timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+    this->timelineSemaphoreFeatures.pNext =
+        const_cast<void *>(deviceCreateInfo.pNext);
+    deviceCreateInfo.pNext = &this->timelineSemaphoreFeatures;
+    this->timelineSemaphoreSupported = true;
+  }
+}
+
+void VkContext::queryExtensionProperties() {
+  if (!this->bindlessSupported) {
+    return;
+  }
+
+  auto getPhysicalDeviceProperties2 =
+      reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+          vkGetInstanceProcAddr(
+              this->instance, "vkGetPhysicalDeviceProperties2KHR"));
+
+  VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexing = {
+      .sType =
+          VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT,
+      .pNext = nullptr,
+  };
+
+  VkPhysicalDeviceProperties2KHR properties = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR,
+      .pNext = &descriptorIndexing,
+  };
+
+  getPhysicalDeviceProperties2(this->physicalDevice, &properties);
+
+  // A combined image sampler counts as both a sampled image and a sampler
+  this->maxBindlessTextures = std::min(
+      {descriptorIndexing.maxPerStageDescriptorUpdateAfterBindSampledImages,
+       descriptorIndexing.maxPerStageDescriptorUpdateAfterBindSamplers,
+       descriptorIndexing.maxDescriptorSetUpdateAfterBindSampledImages,
+       descriptorIndexing.maxDescriptorSetUpdateAfterBindSamplers,
+       descriptorIndexing.maxPerStageUpdateAfterBindResources});
 }
 
 void VkContext::getDeviceQueues() {
@@ -615,6 +1038,8 @@ void VkContext::getDeviceQueues() {
       this->device, this->graphicsQueueFamilyIndex, 0, &this->graphicsQueue);
   vkGetDeviceQueue(
       this->device, this->presentQueueFamilyIndex, 0, &this->presentQueue);
+  vkGetDeviceQueue(
+      this->device, this->transferQueueFamilyIndex, 0, &this->transferQueue);
 }
 
 void VkContext::setupMemoryAllocator() {
@@ -626,17 +1051,119 @@ void VkContext::setupMemoryAllocator() {
   vmaCreateAllocator(&allocatorInfo, &this->allocator);
 }
 
-void VkContext::createSyncObjects() {
-  VkSemaphoreCreateInfo semaphoreCreateInfo = {
-      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+void VkContext::createPipelineCache() {
+  std::vector<char> initialData = this->loadPipelineCacheData();
+
+  VkPipelineCacheCreateInfo createInfo = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
+      .initialDataSize = initialData.size(),
+      .pInitialData = initialData.empty() ? nullptr : initialData.data(),
+  };
+
+  if (vkCreatePipelineCache(
+          this->device, &createInfo, nullptr, &this->pipelineCache) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create pipeline cache");
+  }
+}
+
+std::vector<char> VkContext::loadPipelineCacheData() {
+  std::ifstream file(PIPELINE_CACHE_PATH, std::ios::binary);
+
+  if (file.fail()) {
+    return {};
+  }
+
+  PipelineCacheFileHeader header;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+  if (file.fail() || header.magic != PIPELINE_CACHE_MAGIC ||
+      header.vendorID != this->physicalDeviceProperties.vendorID ||
+      header.deviceID != this->physicalDeviceProperties.deviceID ||
+      header.driverVersion != this->physicalDeviceProperties.driverVersion ||
+      memcmp(
+          header.pipelineCacheUUID,
+          this->physicalDeviceProperties.pipelineCacheUUID,
+          VK_UUID_SIZE) != 0) {
+    std::cout << "Discarding pipeline cache written for another device"
+              << std::endl;
+    return {};
+  }
+
+  std::vector<char> data(header.dataSize);
+  file.read(data.data(), data.size());
+
+  if (file.fail()) {
+    std::cout << "Discarding truncated pipeline cache" << std::endl;
+    return {};
+  }
+
+  return data;
+}
+
+void VkContext::savePipelineCache() {
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(
+          this->device, this->pipelineCache, &dataSize, nullptr) !=
+      VK_SUCCESS) {
+    std::cout << "Failed to get pipeline cache data" << std::endl;
+    return;
+  }
+
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(
+          this->device, this->pipelineCache, &dataSize, data.data()) !=
+      VK_SUCCESS) {
+    std::cout << "Failed to get pipeline cache data" << std::endl;
+    return;
+  }
+
+  PipelineCacheFileHeader header = {
+      .magic = PIPELINE_CACHE_MAGIC,
+      .dataSize = static_cast<uint32_t>(dataSize),
+      .vendorID = this->physicalDeviceProperties.vendorID,
+      .deviceID = this->physicalDeviceProperties.deviceID,
+      .driverVersion = this->physicalDeviceProperties.driverVersion,
   };
+  memcpy(
+      header.pipelineCacheUUID,
+      this->physicalDeviceProperties.pipelineCacheUUID,
+      VK_UUID_SIZE);
+
+  std::ofstream file(PIPELINE_CACHE_PATH, std::ios::binary);
+  if (file.fail()) {
+    std::cout << "Failed to open \"" << PIPELINE_CACHE_PATH
+              << "\" for writing" << std::endl;
+    return;
+  }
 
-  VkFenceCreateInfo fenceCreateInfo = {
-      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(data.data(), dataSize);
+}
+
+void VkContext::createProfiler() {
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(
+      this->physicalDevice, &queueFamilyCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(
+      this->physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+  this->profiler.create(
+      this->device,
+      this->physicalDeviceProperties,
+      queueFamilyProperties[this->graphicsQueueFamilyIndex].timestampValidBits,
+      MAX_FRAMES_IN_FLIGHT);
+}
+
+void VkContext::createSyncObjects() {
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
       .pNext = nullptr,
-      .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+      .flags = 0,
   };
 
   for (auto &resources : this->frameResources) {
@@ -649,13 +1176,12 @@ void VkContext::createSyncObjects() {
              this->device,
              &semaphoreCreateInfo,
              nullptr,
-             &resources.renderingFinishedSemaphore) != VK_SUCCESS) ||
-        (vkCreateFence(
-             this->device, &fenceCreateInfo, nullptr, &resources.fence) !=
-         VK_SUCCESS)) {
+             &resources.renderingFinishedSemaphore) != VK_SUCCESS)) {
       throw std::runtime_error("Failed to create semaphores");
     }
   }
+
+  this->frameTimeline.create(this->device, this->timelineSemaphoreSupported);
 }
 
 void VkContext::createSwapchain(uint32_t width, uint32_t height) {
@@ -763,6 +1289,122 @@ void VkContext::createSwapchain(uint32_t width, uint32_t height) {
       device, this->swapchain, &imageCount, this->swapchainImages.data());
 }
 
+void VkContext::createOffscreenImages(uint32_t width, uint32_t height) {
+  for (const auto &imageView : this->swapchainImageViews) {
+    if (imageView != VK_NULL_HANDLE) {
+      vkDestroyImageView(this->device, imageView, nullptr);
+    }
+  }
+  this->swapchainImageViews.clear();
+
+  this->destroyOffscreenImages();
+
+  this->swapchainImageFormat = HEADLESS_IMAGE_FORMAT;
+  this->swapchainExtent = {width, height};
+
+  // Every frame in flight renders to its own image, so an image is free as
+  // soon as the frame was waited on
+  this->swapchainImages.resize(MAX_FRAMES_IN_FLIGHT);
+  this->offscreenImageAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    VkImageCreateInfo imageCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = this->swapchainImageFormat,
+        .extent =
+            {
+                .width = width,
+                .height = height,
+                .depth = 1,
+            },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    if (vmaCreateImage(
+            this->allocator,
+            &imageCreateInfo,
+            &allocInfo,
+            &this->swapchainImages[i],
+            &this->offscreenImageAllocations[i],
+            nullptr) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create one of the offscreen images");
+    }
+  }
+
+  VkBufferCreateInfo bufferCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size = static_cast<VkDeviceSize>(width) * height * 4,
+      .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = 0,
+      .pQueueFamilyIndices = nullptr,
+  };
+
+  VmaAllocationCreateInfo bufferAllocInfo = {};
+  bufferAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  bufferAllocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+  bufferAllocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  for (auto &resources : this->frameResources) {
+    VmaAllocationInfo allocationInfo;
+    if (vmaCreateBuffer(
+            this->allocator,
+            &bufferCreateInfo,
+            &bufferAllocInfo,
+            &resources.readbackBuffer,
+            &resources.readbackAllocation,
+            &allocationInfo) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create one of the readback buffers");
+    }
+
+    resources.readbackData = allocationInfo.pMappedData;
+  }
+}
+
+void VkContext::destroyOffscreenImages() {
+  for (size_t i = 0; i < this->offscreenImageAllocations.size(); i++) {
+    vmaDestroyImage(
+        this->allocator,
+        this->swapchainImages[i],
+        this->offscreenImageAllocations[i]);
+  }
+
+  if (!this->offscreenImageAllocations.empty()) {
+    this->swapchainImages.clear();
+    this->offscreenImageAllocations.clear();
+  }
+
+  for (auto &resources : this->frameResources) {
+    if (resources.readbackBuffer != VK_NULL_HANDLE) {
+      vmaDestroyBuffer(
+          this->allocator,
+          resources.readbackBuffer,
+          resources.readbackAllocation);
+      resources.readbackBuffer = VK_NULL_HANDLE;
+      resources.readbackAllocation = VK_NULL_HANDLE;
+      resources.readbackData = nullptr;
+    }
+  }
+}
+
 void VkContext::createSwapchainImageViews() {
   this->swapchainImageViews.resize(this->swapchainImages.size());
 
@@ -939,8 +1581,10 @@ void VkContext::createRenderPass() {
           .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
           .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
           .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-          .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, // TODO: maybe change
-                                                          // this
+          // Headless frames end up copied to host memory instead of being
+          // presented
+          .finalLayout = this->headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                        : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
       },
       VkAttachmentDescription{
           .flags = 0,
@@ -1011,15 +1655,26 @@ void VkContext::createRenderPass() {
       VK_SUCCESS) {
     throw std::runtime_error("Failed to create render pass");
   }
+
+  this->renderPassFormat = this->swapchainImageFormat;
+  this->renderPassVersion++;
 }
 
-void VkContext::regenFramebuffer(
-    VkFramebuffer &framebuffer,
-    VkImageView colorImageView,
-    VkImageView depthImageView) {
-  if (framebuffer != VK_NULL_HANDLE) {
-    vkDestroyFramebuffer(this->device, framebuffer, nullptr);
-    framebuffer = VK_NULL_HANDLE;
+void VkContext::createFramebuffers() {
+  for (const auto &colorImageView : this->swapchainImageViews) {
+    for (const auto &resources : this->frameResources) {
+      this->getFramebuffer(colorImageView, resources.depthImageView);
+    }
+  }
+}
+
+VkFramebuffer VkContext::getFramebuffer(
+    VkImageView colorImageView, VkImageView depthImageView) {
+  FramebufferKey key{colorImageView, depthImageView, this->renderPass};
+
+  auto it = this->framebuffers.find(key);
+  if (it != this->framebuffers.end()) {
+    return it->second;
   }
 
   std::array<VkImageView, 2> attachments{
@@ -1039,16 +1694,181 @@ void VkContext::regenFramebuffer(
       .layers = 1,
   };
 
+  VkFramebuffer framebuffer{VK_NULL_HANDLE};
   if (vkCreateFramebuffer(this->device, &createInfo, nullptr, &framebuffer) !=
       VK_SUCCESS) {
     throw std::runtime_error("Failed to create framebuffer");
   }
+
+  this->framebufferCreationCount++;
+  this->framebuffers[key] = framebuffer;
+
+  return framebuffer;
+}
+
+void VkContext::destroyFramebuffers() {
+  for (const auto &framebuffer : this->framebuffers) {
+    vkDestroyFramebuffer(this->device, framebuffer.second, nullptr);
+  }
+  this->framebuffers.clear();
+}
+
+void VkContext::allocateSecondaryCommandBuffers(
+    FrameResources &resources, uint32_t count) {
+  while (resources.secondaryCommandPools.size() < count) {
+    VkCommandPoolCreateInfo cmdPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = this->graphicsQueueFamilyIndex,
+    };
+
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(
+            this->device, &cmdPoolCreateInfo, nullptr, &commandPool) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to create secondary command pool");
+    }
+    resources.secondaryCommandPools.push_back(commandPool);
+
+    VkCommandBufferAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = 1,
+    };
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(
+            this->device, &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to allocate secondary command buffer");
+    }
+    resources.secondaryCommandBuffers.push_back(commandBuffer);
+  }
+}
+
+void VkContext::setDynamicState(VkCommandBuffer commandBuffer) {
+  VkViewport viewport = {
+      .x = 0.0f,
+      .y = 0.0f,
+      .width = static_cast<float>(this->swapchainExtent.width),
+      .height = static_cast<float>(this->swapchainExtent.height),
+      .minDepth = 0.0f,
+      .maxDepth = 1.0f,
+  };
+
+  VkRect2D scissor{{
+                       .x = 0,
+                       .y = 0,
+                   },
+                   this->swapchainExtent};
+
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void VkContext::recordReadback(
+    VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+  FrameResources &resources = this->frameResources[this->currentFrame];
+
+  // The render pass already left the image in TRANSFER_SRC_OPTIMAL
+  VkImageMemoryBarrier imageMemoryBarrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = this->swapchainImages[imageIndex],
+      .subresourceRange =
+          {
+              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+              .baseMipLevel = 0,
+              .levelCount = 1,
+              .baseArrayLayer = 0,
+              .layerCount = 1,
+          },
+  };
+
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &imageMemoryBarrier);
+
+  VkBufferImageCopy bufferImageCopyInfo = {
+      .bufferOffset = 0,
+      .bufferRowLength = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource =
+          {
+              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+              .mipLevel = 0,
+              .baseArrayLayer = 0,
+              .layerCount = 1,
+          },
+      .imageOffset =
+          {
+              .x = 0,
+              .y = 0,
+              .z = 0,
+          },
+      .imageExtent =
+          {
+              .width = this->swapchainExtent.width,
+              .height = this->swapchainExtent.height,
+              .depth = 1,
+          },
+  };
+
+  vkCmdCopyImageToBuffer(
+      commandBuffer,
+      this->swapchainImages[imageIndex],
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      resources.readbackBuffer,
+      1,
+      &bufferImageCopyInfo);
+
+  VkBufferMemoryBarrier bufferMemoryBarrier = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .buffer = resources.readbackBuffer,
+      .offset = 0,
+      .size = VK_WHOLE_SIZE,
+  };
+
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      0,
+      nullptr,
+      1,
+      &bufferMemoryBarrier,
+      0,
+      nullptr);
 }
 
 void VkContext::destroyResizables() {
   if (this->device != VK_NULL_HANDLE) {
     vkDeviceWaitIdle(this->device);
 
+    this->destroyFramebuffers();
+
     for (auto &resources : this->frameResources) {
       if (resources.commandBuffer != VK_NULL_HANDLE) {
         vkFreeCommandBuffers(
@@ -1069,11 +1889,6 @@ void VkContext::destroyResizables() {
         resources.depthImageAllocation = VK_NULL_HANDLE;
       }
     }
-
-    if (this->renderPass != VK_NULL_HANDLE) {
-      vkDestroyRenderPass(this->device, this->renderPass, nullptr);
-      this->renderPass = VK_NULL_HANDLE;
-    }
   }
 }
 
@@ -1084,45 +1899,140 @@ void VkContext::onResize(uint32_t width, uint32_t height) {
 
   this->destroyResizables();
 
-  this->createSwapchain(this->window->getWidth(), this->window->getHeight());
+  if (this->headless) {
+    this->createOffscreenImages(
+        this->window->getWidth(), this->window->getHeight());
+  } else {
+    this->createSwapchain(this->window->getWidth(), this->window->getHeight());
+  }
   this->createSwapchainImageViews();
   this->createDepthResources();
-  this->createRenderPass();
+
+  // The render pass only depends on the attachment formats, so it (and every
+  // pipeline created against it) survives the resize unless the swapchain
+  // format changed
+  if (this->swapchainImageFormat != this->renderPassFormat) {
+    vkDestroyRenderPass(this->device, this->renderPass, nullptr);
+    this->createRenderPass();
+  }
+
+  this->createFramebuffers();
   this->allocateGraphicsCommandBuffers();
 }
 
-void VkContext::present(DrawFunction drawFunction) {
-  if (vkWaitForFences(
-          this->device,
-          1,
-          &this->frameResources[this->currentFrame].fence,
-          VK_TRUE,
-          UINT64_MAX) != VK_SUCCESS) {
-    throw std::runtime_error("Waiting for fence took too long");
-  }
+void VkContext::present(
+    DrawFunction drawFunction, DrawFunction prePassFunction) {
+  this->presentFrame(
+      VK_SUBPASS_CONTENTS_INLINE,
+      prePassFunction,
+      [&](VkCommandBuffer commandBuffer, VkFramebuffer framebuffer) {
+        this->setDynamicState(commandBuffer);
+        drawFunction(commandBuffer);
+      });
+}
+
+void VkContext::present(
+    uint32_t chunkCount,
+    ParallelDrawFunction drawFunction,
+    DrawFunction prePassFunction) {
+  this->presentFrame(
+      VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS,
+      prePassFunction,
+      [&](VkCommandBuffer commandBuffer, VkFramebuffer framebuffer) {
+        // vkCmdExecuteCommands needs at least one buffer, the render pass
+        // is left empty instead
+        if (chunkCount == 0) {
+          return;
+        }
+
+        FrameResources &resources = this->frameResources[this->currentFrame];
+
+        this->allocateSecondaryCommandBuffers(resources, chunkCount);
+
+        this->threadPool.parallelFor(chunkCount, [&](uint32_t chunk) {
+          VkCommandBuffer secondaryCommandBuffer =
+              resources.secondaryCommandBuffers[chunk];
+
+          // Every chunk has its own pool, so no two threads ever record
+          // into buffers from the same pool
+          vkResetCommandPool(
+              this->device, resources.secondaryCommandPools[chunk], 0);
+
+          VkCommandBufferInheritanceInfo inheritanceInfo = {
+              .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+              .pNext = nullptr,
+              .renderPass = this->renderPass,
+              .subpass = 0,
+              .framebuffer = framebuffer,
+              .occlusionQueryEnable = VK_FALSE,
+              .queryFlags = 0,
+              .pipelineStatistics = 0,
+          };
+
+          VkCommandBufferBeginInfo beginInfo = {
+              .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+              .pNext = nullptr,
+              .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                       VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+              .pInheritanceInfo = &inheritanceInfo,
+          };
+
+          vkBeginCommandBuffer(secondaryCommandBuffer, &beginInfo);
+
+          // Dynamic state isn't inherited from the primary command buffer
+          this->setDynamicState(secondaryCommandBuffer);
+
+          drawFunction(secondaryCommandBuffer, chunk);
+
+          if (vkEndCommandBuffer(secondaryCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record command buffers");
+          }
+        });
+
+        vkCmdExecuteCommands(
+            commandBuffer,
+            chunkCount,
+            resources.secondaryCommandBuffers.data());
+      });
+}
+
+GpuProfiler *VkContext::getProfiler() {
+  return &this->profiler;
+}
 
-  vkResetFences(
-      this->device, 1, &this->frameResources[this->currentFrame].fence);
+uint32_t VkContext::getWorkerThreadCount() const {
+  return this->threadPool.getThreadCount();
+}
+
+void VkContext::presentFrame(
+    VkSubpassContents subpassContents,
+    DrawFunction prePassFunction,
+    std::function<void(VkCommandBuffer, VkFramebuffer)> recordFunction) {
+  this->waitForCurrentFrame();
 
   uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(
-      this->device,
-      this->swapchain,
-      UINT64_MAX,
-      this->frameResources[this->currentFrame].imageAvailableSemaphore,
-      VK_NULL_HANDLE,
-      &imageIndex);
-
-  switch (result) {
-  case VK_SUCCESS:
-  case VK_SUBOPTIMAL_KHR:
-    break;
-  case VK_ERROR_OUT_OF_DATE_KHR:
-    this->onResize(this->window->getWidth(), this->window->getHeight());
-    return;
-  default:
-    throw std::runtime_error(
-        "Problem occurred during swap chain image acquisition");
+  if (this->headless) {
+    imageIndex = static_cast<uint32_t>(this->currentFrame);
+  } else {
+    VkResult result = vkAcquireNextImageKHR(
+        this->device,
+        this->swapchain,
+        UINT64_MAX,
+        this->frameResources[this->currentFrame].imageAvailableSemaphore,
+        VK_NULL_HANDLE,
+        &imageIndex);
+
+    switch (result) {
+    case VK_SUCCESS:
+    case VK_SUBOPTIMAL_KHR:
+      break;
+    case VK_ERROR_OUT_OF_DATE_KHR:
+      this->onResize(this->window->getWidth(), this->window->getHeight());
+      return;
+    default:
+      throw std::runtime_error(
+          "Problem occurred during swap chain image acquisition");
+    }
   }
 
   VkImageSubresourceRange imageSubresourceRange = {
@@ -1134,8 +2044,7 @@ void VkContext::present(DrawFunction drawFunction) {
   };
 
   {
-    this->regenFramebuffer(
-        this->frameResources[this->currentFrame].framebuffer,
+    VkFramebuffer framebuffer = this->getFramebuffer(
         this->swapchainImageViews[imageIndex],
         this->frameResources[this->currentFrame].depthImageView);
 
@@ -1149,6 +2058,15 @@ void VkContext::present(DrawFunction drawFunction) {
     vkBeginCommandBuffer(
         this->frameResources[this->currentFrame].commandBuffer, &beginInfo);
 
+    // The frame in flight was waited on, so last time's results are ready
+    this->profiler.beginFrame(
+        this->frameResources[this->currentFrame].commandBuffer,
+        static_cast<uint32_t>(this->currentFrame));
+
+    if (prePassFunction) {
+      prePassFunction(this->frameResources[this->currentFrame].commandBuffer);
+    }
+
     if (this->presentQueue != this->graphicsQueue) {
       VkImageMemoryBarrier barrierFromPresentToDraw = {
           .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -1185,47 +2103,31 @@ void VkContext::present(DrawFunction drawFunction) {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
         .pNext = nullptr,
         .renderPass = this->renderPass,
-        .framebuffer = this->frameResources[this->currentFrame].framebuffer,
+        .framebuffer = framebuffer,
         .renderArea = {{.x = 0, .y = 0}, this->swapchainExtent},
         .clearValueCount = static_cast<uint32_t>(clearValues.size()),
         .pClearValues = clearValues.data(),
     };
 
+    this->profiler.beginScope(
+        this->frameResources[this->currentFrame].commandBuffer, "render pass");
+
     vkCmdBeginRenderPass(
         this->frameResources[this->currentFrame].commandBuffer,
         &renderPassBeginInfo,
-        VK_SUBPASS_CONTENTS_INLINE);
-
-    VkViewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = static_cast<float>(this->swapchainExtent.width),
-        .height = static_cast<float>(this->swapchainExtent.height),
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
-    };
-
-    VkRect2D scissor{{
-                         .x = 0,
-                         .y = 0,
-                     },
-                     this->swapchainExtent};
+        subpassContents);
 
-    vkCmdSetViewport(
-        this->frameResources[this->currentFrame].commandBuffer,
-        0,
-        1,
-        &viewport);
-    vkCmdSetScissor(
-        this->frameResources[this->currentFrame].commandBuffer, 0, 1, &scissor);
+    // Callback
+    recordFunction(
+        this->frameResources[this->currentFrame].commandBuffer, framebuffer);
   }
 
-  // Callback
-  drawFunction(this->frameResources[this->currentFrame].commandBuffer);
-
   {
     vkCmdEndRenderPass(this->frameResources[this->currentFrame].commandBuffer);
 
+    this->profiler.endScope(
+        this->frameResources[this->currentFrame].commandBuffer);
+
     if (this->presentQueue != this->graphicsQueue) {
       VkImageMemoryBarrier barrierFromDrawToPresent = {
           .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -1253,6 +2155,14 @@ void VkContext::present(DrawFunction drawFunction) {
           &barrierFromDrawToPresent);
     }
 
+    if (this->headless && this->readbackEnabled) {
+      this->recordReadback(
+          this->frameResources[this->currentFrame].commandBuffer, imageIndex);
+    }
+
+    this->profiler.endFrame(
+        this->frameResources[this->currentFrame].commandBuffer);
+
     if (vkEndCommandBuffer(
             this->frameResources[this->currentFrame].commandBuffer) !=
         VK_SUCCESS) {
@@ -1278,41 +2188,50 @@ void VkContext::present(DrawFunction drawFunction) {
           &this->frameResources[this->currentFrame].renderingFinishedSemaphore,
   };
 
-  if (vkQueueSubmit(
-          this->graphicsQueue,
-          1,
-          &submitInfo,
-          this->frameResources[this->currentFrame].fence) != VK_SUCCESS) {
+  if (this->headless) {
+    // No image is acquired or presented, so there's nothing to wait for or
+    // signal
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.signalSemaphoreCount = 0;
+  }
+
+  if (this->frameTimeline.submit(
+          this->graphicsQueue, submitInfo, this->frameNumber + 1) !=
+      VK_SUCCESS) {
     throw std::runtime_error(
         "Failed to submit to the command buffer to presentation queue");
   }
 
-  VkPresentInfoKHR presentInfo = {
-      .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-      .pNext = nullptr,
-      .waitSemaphoreCount = 1,
-      .pWaitSemaphores =
-          &this->frameResources[this->currentFrame].renderingFinishedSemaphore,
-      .swapchainCount = 1,
-      .pSwapchains = &this->swapchain,
-      .pImageIndices = &imageIndex,
-      .pResults = nullptr,
-  };
+  if (!this->headless) {
+    VkPresentInfoKHR presentInfo = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &this->frameResources[this->currentFrame]
+                                .renderingFinishedSemaphore,
+        .swapchainCount = 1,
+        .pSwapchains = &this->swapchain,
+        .pImageIndices = &imageIndex,
+        .pResults = nullptr,
+    };
 
-  result = vkQueuePresentKHR(this->presentQueue, &presentInfo);
+    VkResult result = vkQueuePresentKHR(this->presentQueue, &presentInfo);
 
-  switch (result) {
-  case VK_SUCCESS:
-    break;
-  case VK_ERROR_OUT_OF_DATE_KHR:
-  case VK_SUBOPTIMAL_KHR:
-    this->onResize(this->window->getWidth(), this->window->getHeight());
-    return;
-  default:
-    throw std::runtime_error("Failed to queue image presentation");
+    switch (result) {
+    case VK_SUCCESS:
+      break;
+    case VK_ERROR_OUT_OF_DATE_KHR:
+    case VK_SUBOPTIMAL_KHR:
+      // The frame was still submitted, so move on to the next one
+      this->onResize(this->window->getWidth(), this->window->getHeight());
+      break;
+    default:
+      throw std::runtime_error("Failed to queue image presentation");
+    }
   }
 
   this->currentFrame = (this->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  this->frameNumber++;
 }
 
 VkResult CreateDebugReportCallbackEXT(
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "../window/window.hpp"
+#include "../thread/thread_pool.hpp"
+#include "gpu_profiler.hpp"
+#include "timeline_semaphore.hpp"
 #include "../window/event_handler.hpp"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <vector>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
@@ -20,13 +24,49 @@ const std::vector<const char *> REQUIRED_VALIDATION_LAYERS = {
 };
 #endif
 
+// Enabled when the instance supports them. The features and limits of
+// optional device extensions are queried through
+// VK_KHR_get_physical_device_properties2.
+const std::vector<const char *> OPTIONAL_INSTANCE_EXTENSIONS = {
+    VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
+};
+
 const std::vector<const char *> REQUIRED_DEVICE_EXTENSIONS = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 };
 
+// Enabled when the device supports them, the code using them checks
+// isDeviceExtensionEnabled first
+const std::vector<const char *> OPTIONAL_DEVICE_EXTENSIONS = {
+    VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+    // Needed by VK_EXT_descriptor_indexing
+    VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+};
+
+// Optional device extensions that depend on
+// VK_KHR_get_physical_device_properties2, they're skipped if the instance
+// doesn't enable it
+const std::vector<const char *> PROPERTIES_2_DEVICE_EXTENSIONS = {
+    VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+};
+
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Upper bound for the anisotropy of texture samplers
+const float MAX_SAMPLER_ANISOTROPY = 16.0f;
+
+// Format of the offscreen images used in headless mode
+const VkFormat HEADLESS_IMAGE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+const char *const PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
 typedef std::function<void(VkCommandBuffer commandBuffer)> DrawFunction;
+typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t chunk)>
+    ParallelDrawFunction;
 
 class VkContext : public EventHandler {
 public:
@@ -37,13 +77,109 @@ public:
 
   VmaAllocator getAllocator();
   VkDevice getDevice();
+  VkPhysicalDevice getPhysicalDevice();
   VkRenderPass getRenderPass();
+
+  // Returns a number that changes every time the render pass is recreated
+  uint32_t getRenderPassVersion();
   VkQueue getGraphicsQueue();
+  VkPipelineCache getPipelineCache();
+  uint32_t getGraphicsQueueFamilyIndex() const;
+
+  // Queue used for uploads. Same as the graphics queue if the device doesn't
+  // have a separate queue family that supports transfers.
+  VkQueue getTransferQueue();
+  uint32_t getTransferQueueFamilyIndex() const;
+  const VkPhysicalDeviceProperties &getPhysicalDeviceProperties() const;
+
+  // Returns the features that were enabled on the device
+  const VkPhysicalDeviceFeatures &getEnabledFeatures() const;
+
+  // Returns true if an optional device extension was enabled
+  bool isDeviceExtensionEnabled(const char *name) const;
+
+  // Returns true if an optional instance extension was enabled
+  bool isInstanceExtensionEnabled(const char *name) const;
+
+  // Returns true if the descriptor indexing features a bindless texture
+  // table needs were enabled: update after bind, partially bound and
+  // non-uniformly indexed arrays of sampled images
+  bool isBindlessSupported() const;
+
+  // Returns the most textures a bindless descriptor array can hold, 0 if
+  // bindless isn't supported
+  uint32_t getMaxBindlessTextures() const;
+
+  // Returns true if timeline semaphores were enabled. Timelines fall back to
+  // fences without them.
+  bool isTimelineSemaphoreSupported() const;
+
+  // Returns vkCmdDrawIndexedIndirectCountKHR, nullptr if
+  // VK_KHR_draw_indirect_count isn't enabled
+  PFN_vkCmdDrawIndexedIndirectCountKHR getDrawIndexedIndirectCount() const;
+
+  // Returns the anisotropy samplers should use, 1 if anisotropic filtering
+  // isn't supported
+  float getMaxSamplerAnisotropy() const;
+
+  // Returns the index of the frame in flight that is currently being recorded
+  int getCurrentFrame() const;
+
+  // Returns a counter that is incremented every time a frame is presented
+  uint64_t getFrameNumber() const;
+
+  // Returns true once the GPU finished executing the frame with the given
+  // number, and every frame before it. Resources freed while getFrameNumber
+  // returned frameNumber can be reused once it's complete.
+  bool isFrameComplete(uint64_t frameNumber);
+
+  // Waits until the GPU is done with the resources of the current frame in
+  // flight. Cheap to call more than once per frame.
+  void waitForCurrentFrame();
 
   void useTransientCommandBuffer(std::function<void(VkCommandBuffer)> function);
   VkShaderModule createShaderModule(std::vector<char> code);
+  VkShaderModule createShaderModule(const void *code, size_t size);
+
+  // Creates a shader module from a SPIR-V file, handing the memory mapped
+  // file straight to the driver
+  VkShaderModule loadShaderModule(const char *path);
 
-  void present(DrawFunction drawFunction);
+  // prePassFunction, if any, is recorded into the frame's command buffer
+  // before the render pass begins, e.g. for compute passes whose results
+  // the render pass reads
+  void present(
+      DrawFunction drawFunction, DrawFunction prePassFunction = nullptr);
+
+  // Splits the frame's drawing into chunkCount chunks which are recorded in
+  // parallel on the worker threads into secondary command buffers. With no
+  // chunks the frame is presented with an empty render pass.
+  void present(
+      uint32_t chunkCount,
+      ParallelDrawFunction drawFunction,
+      DrawFunction prePassFunction = nullptr);
+
+  // Returns the profiler that measures the GPU time of every frame and of
+  // the scopes opened on it
+  GpuProfiler *getProfiler();
+
+  // Returns the number of threads used to record in parallel
+  uint32_t getWorkerThreadCount() const;
+
+  // Returns true if rendering goes to offscreen images instead of a swapchain
+  bool isHeadless() const;
+
+  // In headless mode, makes every frame copy its image to host memory so it
+  // can be read with readPixels
+  void setReadbackEnabled(bool enabled);
+
+  // Waits for the last presented frame and copies its tightly packed RGBA
+  // pixels into pixels. Only works in headless mode with readback enabled.
+  void readPixels(std::vector<uint8_t> &pixels);
+
+  // Returns how many framebuffers have been created since startup, useful for
+  // checking that no framebuffers are created in steady state
+  uint64_t getFramebufferCreationCount() const;
 
   // EventHandler
   virtual void onResize(uint32_t width, uint32_t height) override;
@@ -51,17 +187,57 @@ public:
 private:
   Window *window{nullptr};
 
+  bool headless = false;
+  bool readbackEnabled = false;
+
   VkInstance instance{VK_NULL_HANDLE};
   VkDebugReportCallbackEXT callback{VK_NULL_HANDLE};
   VkPhysicalDevice physicalDevice{VK_NULL_HANDLE};
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  VkPhysicalDeviceFeatures enabledFeatures = {};
+  std::vector<const char *> enabledOptionalInstanceExtensions;
+  std::vector<const char *> enabledOptionalExtensions;
+
+  // Extension features enabled on the device, chained onto its create info
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {
+      .sType =
+          VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+      .pNext = nullptr,
+  };
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {
+      .sType =
+          VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+      .pNext = nullptr,
+  };
+
+  bool bindlessSupported = false;
+  uint32_t maxBindlessTextures = 0;
+  bool timelineSemaphoreSupported = false;
+
+  PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount{nullptr};
   VkDevice device{VK_NULL_HANDLE};
 
   VmaAllocator allocator{VK_NULL_HANDLE};
 
+  VkPipelineCache pipelineCache{VK_NULL_HANDLE};
+
+  // Written in front of the pipeline cache data on disk, the cache is
+  // discarded if any of these don't match the current device
+  struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t dataSize;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+  };
+
   uint32_t graphicsQueueFamilyIndex;
   uint32_t presentQueueFamilyIndex;
+  uint32_t transferQueueFamilyIndex;
   VkQueue graphicsQueue{VK_NULL_HANDLE};
   VkQueue presentQueue{VK_NULL_HANDLE};
+  VkQueue transferQueue{VK_NULL_HANDLE};
 
   VkSurfaceKHR surface{VK_NULL_HANDLE};
 
@@ -70,8 +246,13 @@ private:
   VkExtent2D swapchainExtent;
   std::vector<VkImage> swapchainImages;
   std::vector<VkImageView> swapchainImageViews;
+  // Memory of the images that replace the swapchain images in headless mode
+  std::vector<VmaAllocation> offscreenImageAllocations;
 
-  VkRenderPass renderPass;
+  VkRenderPass renderPass{VK_NULL_HANDLE};
+  // Swapchain format the render pass was created with
+  VkFormat renderPassFormat{VK_FORMAT_UNDEFINED};
+  uint32_t renderPassVersion = 0;
 
   VkCommandPool graphicsCommandPool{VK_NULL_HANDLE};
   VkCommandPool transientCommandPool{VK_NULL_HANDLE};
@@ -84,16 +265,51 @@ private:
 
     VkSemaphore imageAvailableSemaphore{VK_NULL_HANDLE};
     VkSemaphore renderingFinishedSemaphore{VK_NULL_HANDLE};
-    VkFence fence{VK_NULL_HANDLE};
-
-    VkFramebuffer framebuffer{VK_NULL_HANDLE};
 
     VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+
+    // One pool and secondary command buffer per chunk of parallel recording
+    std::vector<VkCommandPool> secondaryCommandPools;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+
+    // Host visible copy of the frame's image, only used in headless mode
+    VkBuffer readbackBuffer{VK_NULL_HANDLE};
+    VmaAllocation readbackAllocation{VK_NULL_HANDLE};
+    void *readbackData{nullptr};
   };
 
   std::vector<FrameResources> frameResources{MAX_FRAMES_IN_FLIGHT};
 
   int currentFrame = 0;
+  uint64_t frameNumber = 0;
+
+  // Frame n signals n + 1 once the GPU is done with it
+  TimelineSemaphore frameTimeline;
+
+  ThreadPool threadPool{std::thread::hardware_concurrency()};
+
+  GpuProfiler profiler;
+
+  struct FramebufferKey {
+    VkImageView colorImageView;
+    VkImageView depthImageView;
+    VkRenderPass renderPass;
+
+    bool operator<(const FramebufferKey &other) const {
+      if (this->colorImageView != other.colorImageView) {
+        return this->colorImageView < other.colorImageView;
+      }
+      if (this->depthImageView != other.depthImageView) {
+        return this->depthImageView < other.depthImageView;
+      }
+      return this->renderPass < other.renderPass;
+    }
+  };
+
+  // Framebuffers for every swapchain image / depth image combination, only
+  // rebuilt when the swapchain is recreated
+  std::map<FramebufferKey, VkFramebuffer> framebuffers;
+  uint64_t framebufferCreationCount = 0;
 
   // Checks if validation layers are supported
   bool checkValidationLayerSupport();
@@ -102,11 +318,21 @@ private:
   std::vector<const char *>
   getRequiredExtensions(std::vector<const char *> sdlExtensions);
 
+  // Returns the device extensions needed, the swapchain extension isn't
+  // needed in headless mode
+  std::vector<const char *> getRequiredDeviceExtensions();
+
   // Checks if a physical device is suitable and gets its queue indices
   bool checkPhysicalDeviceProperties(
       VkPhysicalDevice physicalDevice,
       uint32_t *selectedGraphicsQueueFamilyIndex,
-      uint32_t *selectedPresentQueueFamilyIndex);
+      uint32_t *selectedPresentQueueFamilyIndex,
+      uint32_t *selectedTransferQueueFamilyIndex);
+
+  // Returns the index of a queue family that supports transfers but not
+  // graphics, preferring transfer-only families, or UINT32_MAX if none
+  uint32_t getTransferQueueFamily(
+      const std::vector<VkQueueFamilyProperties> &queueFamilyProperties);
 
   uint32_t
   getSwapchainNumImages(const VkSurfaceCapabilitiesKHR &surfaceCapabilities);
@@ -134,18 +360,48 @@ private:
   // Creates physical and logical devices
   void createDevice();
 
+  // Checks which features of the enabled optional extensions are supported,
+  // and chains the structs enabling the ones used onto the device create
+  // info
+  void chainExtensionFeatures(VkDeviceCreateInfo &deviceCreateInfo);
+
+  // Queries the limits of the enabled optional extensions
+  void queryExtensionProperties();
+
   // Retrieves the queues from the device
   void getDeviceQueues();
 
   // Sets up Vulkan Memory Allocator from AMD
   void setupMemoryAllocator();
 
-  // Creates the semaphores and fences necessary for presentation
+  // Creates the pipeline cache, loading its initial data from
+  // PIPELINE_CACHE_PATH if it was written for this device and driver
+  void createPipelineCache();
+
+  // Reads the pipeline cache data from disk, returns an empty vector if the
+  // file doesn't exist or doesn't match the current device
+  std::vector<char> loadPipelineCacheData();
+
+  // Writes the pipeline cache data to PIPELINE_CACHE_PATH
+  void savePipelineCache();
+
+  // Creates the profiler's query pools if the graphics queue supports
+  // timestamps
+  void createProfiler();
+
+  // Creates the semaphores necessary for presentation and the frame timeline
   void createSyncObjects();
 
   // Creates the swapchain
   void createSwapchain(uint32_t width, uint32_t height);
 
+  // Creates the images that replace the swapchain in headless mode, one per
+  // frame in flight, along with the readback buffers
+  void createOffscreenImages(uint32_t width, uint32_t height);
+
+  // Destroys the offscreen images and readback buffers
+  void destroyOffscreenImages();
+
   // Creates the swapchain image views
   void createSwapchainImageViews();
 
@@ -164,11 +420,35 @@ private:
   // Creates the renderpass
   void createRenderPass();
 
-  // Deletes (if it exists) and recreates a framebuffer
-  void regenFramebuffer(
-      VkFramebuffer &framebuffer,
-      VkImageView colorImageView,
-      VkImageView depthImageView);
+  // Creates the framebuffers for every swapchain image and depth image
+  void createFramebuffers();
+
+  // Returns the cached framebuffer for the given attachments, creating it if
+  // it doesn't exist yet
+  VkFramebuffer
+  getFramebuffer(VkImageView colorImageView, VkImageView depthImageView);
+
+  // Destroys all cached framebuffers
+  void destroyFramebuffers();
+
+  // Creates the secondary command pools and buffers of a frame until there
+  // are at least count of them
+  void
+  allocateSecondaryCommandBuffers(FrameResources &resources, uint32_t count);
+
+  // Records the copy of a headless frame's image into its readback buffer
+  void recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+  // Records the viewport and scissor covering the whole swapchain image
+  void setDynamicState(VkCommandBuffer commandBuffer);
+
+  // Acquires a swapchain image, records and submits the frame and presents
+  // it. prePassFunction is called before the render pass and recordFunction
+  // inside it.
+  void presentFrame(
+      VkSubpassContents subpassContents,
+      DrawFunction prePassFunction,
+      std::function<void(VkCommandBuffer, VkFramebuffer)> recordFunction);
 
   // Destroys the resources that need to be destroyed when resizing the window
   void destroyResizables();
@@ -0,0 +1,237 @@
+#include "dds_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace vkf;
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+const uint32_t DDS_FOURCC_DXT1 = 0x31545844; // "DXT1"
+const uint32_t DDS_FOURCC_DXT5 = 0x35545844; // "DXT5"
+const uint32_t DDS_FOURCC_DX10 = 0x30315844; // "DX10"
+
+const uint32_t DDS_PIXEL_FORMAT_FOURCC = 0x4;
+
+const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+const uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+const uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+const uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+
+struct DdsPixelFormat {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t rBitMask;
+  uint32_t gBitMask;
+  uint32_t bBitMask;
+  uint32_t aBitMask;
+};
+
+struct DdsHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  DdsPixelFormat pixelFormat;
+  uint32_t caps;
+  uint32_t caps2;
+  uint32_t caps3;
+  uint32_t caps4;
+  uint32_t reserved2;
+};
+
+struct DdsHeaderDx10 {
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+DdsFile::DdsFile(const char *path) : file(path) {
+  size_t fileSize = this->file.getSize();
+  size_t dataOffset = sizeof(uint32_t) + sizeof(DdsHeader);
+
+  if (fileSize < dataOffset) {
+    throw std::runtime_error("Invalid DDS file");
+  }
+
+  uint32_t magic;
+  DdsHeader header;
+  memcpy(&magic, this->file.getData(), sizeof(magic));
+  memcpy(&header, this->file.getData() + sizeof(magic), sizeof(header));
+
+  if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader)) {
+    throw std::runtime_error("Invalid DDS file");
+  }
+
+  if (!(header.pixelFormat.flags & DDS_PIXEL_FORMAT_FOURCC)) {
+    throw std::runtime_error("Uncompressed DDS files aren't supported");
+  }
+
+  switch (header.pixelFormat.fourCC) {
+  case DDS_FOURCC_DXT1:
+    this->format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    break;
+  case DDS_FOURCC_DXT5:
+    this->format = VK_FORMAT_BC3_UNORM_BLOCK;
+    break;
+  case DDS_FOURCC_DX10: {
+    if (fileSize < dataOffset + sizeof(DdsHeaderDx10)) {
+      throw std::runtime_error("Invalid DDS file");
+    }
+
+    DdsHeaderDx10 headerDx10;
+    memcpy(
+        &headerDx10, this->file.getData() + dataOffset, sizeof(headerDx10));
+    dataOffset += sizeof(headerDx10);
+
+    if (headerDx10.arraySize > 1 ||
+        headerDx10.resourceDimension != DDS_DIMENSION_TEXTURE2D ||
+        (headerDx10.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)) {
+      throw std::runtime_error("Invalid or unsupported DDS DX10 header");
+    }
+
+    this->format = getFormatFromDxgi(headerDx10.dxgiFormat);
+    break;
+  }
+  default:
+    break;
+  }
+
+  if (this->format == VK_FORMAT_UNDEFINED) {
+    throw std::runtime_error("Unsupported DDS pixel format");
+  }
+
+  if (header.width == 0 || header.height == 0) {
+    throw std::runtime_error("Invalid DDS dimensions");
+  }
+
+  this->width = header.width;
+  this->height = header.height;
+
+  // floor(log2(max(width, height))) + 1, checked before the levels are
+  // built so a corrupt count can't make the loop run away
+  uint32_t maxMipLevels = 1;
+  for (uint32_t size = std::max(this->width, this->height); size > 1;
+       size /= 2) {
+    maxMipLevels++;
+  }
+
+  if (header.mipMapCount > maxMipLevels) {
+    throw std::runtime_error("DDS file has more mip levels than its size");
+  }
+
+  uint32_t mipLevels = std::max(header.mipMapCount, 1u);
+  size_t blockSize = getBlockSize(this->format);
+
+  size_t offset = 0;
+  uint32_t levelWidth = this->width;
+  uint32_t levelHeight = this->height;
+  for (uint32_t i = 0; i < mipLevels; i++) {
+    size_t blocksWide = std::max((levelWidth + 3) / 4, 1u);
+    size_t blocksHigh = std::max((levelHeight + 3) / 4, 1u);
+
+    TextureLevel level = {
+        .offset = offset,
+        .size = blocksWide * blocksHigh * blockSize,
+        .width = levelWidth,
+        .height = levelHeight,
+    };
+    this->levels.push_back(level);
+
+    offset += level.size;
+    levelWidth = std::max(levelWidth / 2, 1u);
+    levelHeight = std::max(levelHeight / 2, 1u);
+  }
+
+  if (dataOffset + offset > fileSize) {
+    throw std::runtime_error("DDS file is smaller than its mip levels");
+  }
+
+  // Only the levels are used, anything after them (e.g. more array layers)
+  // is ignored
+  this->data = this->file.getData() + dataOffset;
+  this->dataSize = offset;
+}
+
+VkFormat DdsFile::getFormat() const {
+  return this->format;
+}
+
+uint32_t DdsFile::getWidth() const {
+  return this->width;
+}
+
+uint32_t DdsFile::getHeight() const {
+  return this->height;
+}
+
+uint32_t DdsFile::getMipLevels() const {
+  return static_cast<uint32_t>(this->levels.size());
+}
+
+const std::vector<TextureLevel> &DdsFile::getLevels() const {
+  return this->levels;
+}
+
+const unsigned char *DdsFile::getData() const {
+  return this->data;
+}
+
+size_t DdsFile::getDataSize() const {
+  return this->dataSize;
+}
+
+bool DdsFile::isDdsPath(const char *path) {
+  size_t length = strlen(path);
+  if (length < 4) {
+    return false;
+  }
+
+  std::string extension(path + length - 4);
+  std::transform(
+      extension.begin(), extension.end(), extension.begin(), ::tolower);
+  return extension == ".dds";
+}
+
+VkFormat DdsFile::getFormatFromDxgi(uint32_t dxgiFormat) {
+  switch (dxgiFormat) {
+  case DXGI_FORMAT_BC1_UNORM:
+    return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+  case DXGI_FORMAT_BC1_UNORM_SRGB:
+    return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+  case DXGI_FORMAT_BC3_UNORM:
+    return VK_FORMAT_BC3_UNORM_BLOCK;
+  case DXGI_FORMAT_BC3_UNORM_SRGB:
+    return VK_FORMAT_BC3_SRGB_BLOCK;
+  case DXGI_FORMAT_BC7_UNORM:
+    return VK_FORMAT_BC7_UNORM_BLOCK;
+  case DXGI_FORMAT_BC7_UNORM_SRGB:
+    return VK_FORMAT_BC7_SRGB_BLOCK;
+  default:
+    return VK_FORMAT_UNDEFINED;
+  }
+}
+
+size_t DdsFile::getBlockSize(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+  case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    return 8;
+  default:
+    return 16;
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../io/mapped_file.hpp"
+#include "texture.hpp"
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+// Block compressed texture loaded from a DDS file, with its precomputed mip
+// levels. Supports BC1, BC3 and BC7, both with legacy FourCC headers and
+// with DX10 extended headers. The file is memory mapped and the levels are
+// read straight from the mapping.
+class DdsFile {
+public:
+  DdsFile(const char *path);
+  DdsFile(const DdsFile &) = delete;
+  DdsFile &operator=(const DdsFile &) = delete;
+
+  VkFormat getFormat() const;
+  uint32_t getWidth() const;
+  uint32_t getHeight() const;
+  uint32_t getMipLevels() const;
+
+  // Returns where every mip level is located inside the data
+  const std::vector<TextureLevel> &getLevels() const;
+  const unsigned char *getData() const;
+  size_t getDataSize() const;
+
+  // Returns true if the path has a .dds extension
+  static bool isDdsPath(const char *path);
+
+private:
+  MappedFile file;
+
+  VkFormat format{VK_FORMAT_UNDEFINED};
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  std::vector<TextureLevel> levels;
+  const unsigned char *data{nullptr};
+  size_t dataSize = 0;
+
+  // Returns the Vulkan format for a DXGI format, VK_FORMAT_UNDEFINED if
+  // it isn't supported
+  static VkFormat getFormatFromDxgi(uint32_t dxgiFormat);
+
+  // Returns the size in bytes of a 4x4 block of the format
+  static size_t getBlockSize(VkFormat format);
+};
+} // namespace vkf
@@ -0,0 +1,52 @@
+#include "image_file.hpp"
+#include <climits>
+#include <stb_image.h>
+#include <stdexcept>
+
+using namespace vkf;
+
+ImageFile::ImageFile(const char *path) {
+  MappedFile file(path);
+
+  if (file.getSize() > INT_MAX) {
+    throw std::runtime_error("Texture file is too large");
+  }
+
+  int width, height, components;
+  this->data = stbi_load_from_memory(
+      file.getData(),
+      static_cast<int>(file.getSize()),
+      &width,
+      &height,
+      &components,
+      STBI_rgb_alpha);
+
+  if (this->data == nullptr) {
+    throw std::runtime_error("Failed to load texture file");
+  }
+
+  this->width = static_cast<uint32_t>(width);
+  this->height = static_cast<uint32_t>(height);
+}
+
+ImageFile::~ImageFile() {
+  if (this->data != nullptr) {
+    stbi_image_free(this->data);
+  }
+}
+
+uint32_t ImageFile::getWidth() const {
+  return this->width;
+}
+
+uint32_t ImageFile::getHeight() const {
+  return this->height;
+}
+
+const unsigned char *ImageFile::getData() const {
+  return this->data;
+}
+
+size_t ImageFile::getSize() const {
+  return static_cast<size_t>(this->width) * this->height * 4;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../io/mapped_file.hpp"
+#include <cstdint>
+
+namespace vkf {
+// Image decoded to tightly packed RGBA straight from a memory mapped file, so
+// the encoded bytes are never copied before decoding
+class ImageFile {
+public:
+  ImageFile(const char *path);
+  ImageFile(const ImageFile &) = delete;
+  ImageFile &operator=(const ImageFile &) = delete;
+  ~ImageFile();
+
+  uint32_t getWidth() const;
+  uint32_t getHeight() const;
+
+  const unsigned char *getData() const;
+  size_t getSize() const;
+
+private:
+  uint32_t width = 0;
+  uint32_t height = 0;
+  unsigned char *data{nullptr};
+};
+} // namespace vkf
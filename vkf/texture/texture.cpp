@@ -1,31 +1,74 @@
 #include "texture.hpp"
 #include "../framework/framework.hpp"
-#include <stb_image.h>
+#include <algorithm>
+#include <stdexcept>
 
 using namespace vkf;
 
+// Format features needed to generate mips with linear blits
+const VkFormatFeatureFlags MIP_GENERATION_FEATURES =
+    VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
 Texture::Texture() {
 }
 
 Texture::Texture(Framework *framework, uint32_t width, uint32_t height)
     : framework(framework), width(width), height(height) {
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(
+      this->framework->getContext()->getPhysicalDevice(),
+      VK_FORMAT_R8G8B8A8_UNORM,
+      &formatProperties);
+
+  if ((formatProperties.optimalTilingFeatures & MIP_GENERATION_FEATURES) ==
+      MIP_GENERATION_FEATURES) {
+    this->mipLevels = getMipLevelCount(width, height);
+  }
+
+  // The mips are blitted from the previous level
+  this->createImage(
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+      VK_IMAGE_USAGE_SAMPLED_BIT);
+}
+
+Texture::Texture(
+    Framework *framework,
+    uint32_t width,
+    uint32_t height,
+    VkFormat format,
+    uint32_t mipLevels)
+    : framework(framework),
+      width(width),
+      height(height),
+      format(format),
+      mipLevels(mipLevels) {
+  if (!isFormatSupported(framework, format)) {
+    throw std::runtime_error("Texture format isn't supported by the device");
+  }
+
+  this->createImage(
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+}
+
+void Texture::createImage(VkImageUsageFlags usage) {
   VkImageCreateInfo imageCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
       .imageType = VK_IMAGE_TYPE_2D,
-      .format = VK_FORMAT_R8G8B8A8_UNORM,
+      .format = this->format,
       .extent =
           {
-              .width = width,
-              .height = height,
+              .width = this->width,
+              .height = this->height,
               .depth = 1,
           },
-      .mipLevels = 1,
+      .mipLevels = this->mipLevels,
       .arrayLayers = 1,
       .samples = VK_SAMPLE_COUNT_1_BIT,
       .tiling = VK_IMAGE_TILING_OPTIMAL,
-      .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      .usage = usage,
       .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
       .queueFamilyIndexCount = 0,
       .pQueueFamilyIndices = nullptr,
@@ -49,7 +92,7 @@ Texture::Texture(Framework *framework, uint32_t width, uint32_t height)
       .flags = 0,
       .image = this->image,
       .viewType = VK_IMAGE_VIEW_TYPE_2D,
-      .format = VK_FORMAT_R8G8B8A8_UNORM,
+      .format = this->format,
       .components =
           {
               .r = VK_COMPONENT_SWIZZLE_IDENTITY,
@@ -61,7 +104,7 @@ Texture::Texture(Framework *framework, uint32_t width, uint32_t height)
           {
               .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
               .baseMipLevel = 0,
-              .levelCount = 1,
+              .levelCount = this->mipLevels,
               .baseArrayLayer = 0,
               .layerCount = 1,
           },
@@ -75,23 +118,26 @@ Texture::Texture(Framework *framework, uint32_t width, uint32_t height)
     throw std::runtime_error("Failed to create image view");
   }
 
+  float maxAnisotropy =
+      this->framework->getContext()->getMaxSamplerAnisotropy();
+
   VkSamplerCreateInfo samplerCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
       .magFilter = VK_FILTER_LINEAR,
       .minFilter = VK_FILTER_LINEAR,
-      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
       .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
       .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
       .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
       .mipLodBias = 0.0f,
-      .anisotropyEnable = VK_FALSE,
-      .maxAnisotropy = 1.0f,
+      .anisotropyEnable = maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE,
+      .maxAnisotropy = maxAnisotropy,
       .compareEnable = VK_FALSE,
       .compareOp = VK_COMPARE_OP_ALWAYS,
       .minLod = 0.0f,
-      .maxLod = 0.0f,
+      .maxLod = static_cast<float>(this->mipLevels),
       .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
       .unnormalizedCoordinates = VK_FALSE,
   };
@@ -105,9 +151,11 @@ Texture::Texture(Framework *framework, uint32_t width, uint32_t height)
   }
 }
 
-void Texture::destroy() {
+void Texture::destroy(bool waitForDevice) {
   if (this->framework->getContext()->getDevice() != VK_NULL_HANDLE) {
-    vkDeviceWaitIdle(this->framework->getContext()->getDevice());
+    if (waitForDevice) {
+      vkDeviceWaitIdle(this->framework->getContext()->getDevice());
+    }
 
     if (this->sampler != VK_NULL_HANDLE) {
       vkDestroySampler(
@@ -149,3 +197,28 @@ uint32_t Texture::getWidth() const {
 uint32_t Texture::getHeight() const {
   return this->height;
 }
+
+uint32_t Texture::getMipLevels() const {
+  return this->mipLevels;
+}
+
+VkFormat Texture::getFormat() const {
+  return this->format;
+}
+
+bool Texture::isFormatSupported(Framework *framework, VkFormat format) {
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(
+      framework->getContext()->getPhysicalDevice(), format, &formatProperties);
+
+  return (formatProperties.optimalTilingFeatures &
+          VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+uint32_t Texture::getMipLevelCount(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+    levels++;
+  }
+  return levels;
+}
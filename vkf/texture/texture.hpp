@@ -1,20 +1,39 @@
 #pragma once
 
-#include <stb_image.h>
-#include <stdexcept>
 #include <vector>
 #include <vk_mem_alloc.h>
 
 namespace vkf {
 class Framework;
 
+// Location of a mip level inside a texture's data
+struct TextureLevel {
+  size_t offset;
+  size_t size;
+  uint32_t width;
+  uint32_t height;
+};
+
 class Texture {
 public:
   Texture();
+  // Creates an RGBA texture with a full mip chain, or with a single level if
+  // the format can't be blitted with linear filtering
   Texture(Framework *framework, uint32_t width, uint32_t height);
+
+  // Creates a texture whose mip levels are all uploaded, e.g. from a block
+  // compressed file. Throws if the device can't sample the format.
+  Texture(
+      Framework *framework,
+      uint32_t width,
+      uint32_t height,
+      VkFormat format,
+      uint32_t mipLevels);
   ~Texture(){};
 
-  void destroy();
+  // Waits for the device to be idle first, unless waitForDevice is false
+  // because the caller knows no submitted work uses the texture anymore
+  void destroy(bool waitForDevice = true);
 
   VkImage getImageHandle();
   VkImageView getImageViewHandle();
@@ -22,38 +41,29 @@ public:
 
   uint32_t getWidth() const;
   uint32_t getHeight() const;
+  uint32_t getMipLevels() const;
+  VkFormat getFormat() const;
 
-  static std::vector<unsigned char>
-  loadDataFromFile(const char *path, uint32_t *width, uint32_t *height) {
-    int iwidth, iheight, n_components;
-    unsigned char *imageData =
-        stbi_load(path, &iwidth, &iheight, &n_components, STBI_rgb_alpha);
-
-    if (imageData == nullptr) {
-      throw std::runtime_error("Failed to load texture file");
-    }
-
-    *width = static_cast<uint32_t>(iwidth);
-    *height = static_cast<uint32_t>(iheight);
+  // Returns true if the device supports sampling images of the format
+  static bool isFormatSupported(Framework *framework, VkFormat format);
 
-    size_t imageSize = (*width) * (*height) * 4;
-
-    std::vector<unsigned char> data(imageData, imageData + imageSize);
-
-    stbi_image_free(imageData);
-
-    return data;
-  }
+  // Returns the number of levels in a full mip chain for the given size
+  static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
 
 protected:
   Framework *framework{nullptr};
 
   uint32_t width = 0;
   uint32_t height = 0;
+  VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+  uint32_t mipLevels = 1;
 
   VkImage image{VK_NULL_HANDLE};
   VkImageView imageView{VK_NULL_HANDLE};
   VkSampler sampler{VK_NULL_HANDLE};
   VmaAllocation imageAllocation{VK_NULL_HANDLE};
+
+  // Creates the image, its view and its sampler
+  void createImage(VkImageUsageFlags usage);
 };
 } // namespace vkf
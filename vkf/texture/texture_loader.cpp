@@ -0,0 +1,330 @@
+#include "texture_loader.hpp"
+#include "../asset/asset_pack.hpp"
+#include "../framework/framework.hpp"
+#include "dds_file.hpp"
+#include "image_file.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace vkf;
+
+// Leaves a core for the thread that renders
+static uint32_t getDecodeThreadCount() {
+  return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+TextureLoader::TextureLoader(Framework *framework)
+    : framework(framework), threadPool(getDecodeThreadCount()) {
+  const unsigned char white[] = {255, 255, 255, 255};
+
+  this->placeholder = {this->framework, 1, 1};
+  this->framework->getUploadQueue()->enqueue(
+      this->placeholder, white, sizeof(white));
+}
+
+TextureLoader::~TextureLoader() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  // Queued decodes bail out, the ones already running are waited for
+  this->stopping = true;
+  this->decodedCondition.wait(lock, [this]() { return !this->isDecoding(); });
+
+  for (auto &entry : this->loads) {
+    Load &load = *entry.second;
+    if (load.state == STATE_UPLOADING || load.state == STATE_RESIDENT) {
+      load.texture.destroy();
+    }
+  }
+  this->loads.clear();
+
+  for (auto &pending : this->pendingDestroys) {
+    pending.texture.destroy();
+  }
+  this->pendingDestroys.clear();
+
+  this->placeholder.destroy();
+}
+
+TextureHandle TextureLoader::load(const char *path) {
+  Load *load;
+  TextureHandle handle;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    handle = this->nextHandle++;
+    load = new Load;
+    load->path = path;
+    this->loads[handle] = std::unique_ptr<Load>(load);
+  }
+
+  // The load isn't erased until the worker is done with it
+  this->threadPool.enqueue([this, load]() { this->decode(load); });
+
+  return handle;
+}
+
+TextureHandle TextureLoader::load(AssetPack &pack, const char *name) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  std::unique_ptr<Load> load(new Load);
+  load->path = name;
+  load->uploadTicket = pack.loadTexture(name, load->texture);
+  load->state = STATE_UPLOADING;
+
+  TextureHandle handle = this->nextHandle++;
+  this->loads[handle] = std::move(load);
+
+  return handle;
+}
+
+bool TextureLoader::isResident(TextureHandle handle) {
+  return this->getTexture(handle) != nullptr;
+}
+
+Texture *TextureLoader::getTexture(TextureHandle handle) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->loads.find(handle);
+  if (it == this->loads.end() || it->second->state != STATE_RESIDENT) {
+    return nullptr;
+  }
+
+  return &it->second->texture;
+}
+
+Texture *TextureLoader::getPlaceholder() {
+  return &this->placeholder;
+}
+
+Texture *TextureLoader::wait(TextureHandle handle) {
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  auto it = this->loads.find(handle);
+  if (it == this->loads.end()) {
+    throw std::runtime_error("Waited on an unknown texture handle");
+  }
+
+  Load &load = *it->second;
+
+  this->decodedCondition.wait(
+      lock, [&load]() { return load.state != STATE_DECODING; });
+
+  if (load.state == STATE_DECODED) {
+    this->upload(load);
+  }
+
+  if (load.state == STATE_FAILED) {
+    throw std::runtime_error(
+        "Failed to load texture \"" + load.path + "\": " + load.error);
+  }
+
+  if (load.state == STATE_UPLOADING) {
+    this->framework->getUploadQueue()->wait(load.uploadTicket);
+    load.state = STATE_RESIDENT;
+  }
+
+  return &load.texture;
+}
+
+void TextureLoader::waitIdle() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  this->decodedCondition.wait(lock, [this]() { return !this->isDecoding(); });
+
+  // Tickets increase monotonically, so waiting for the last one is enough
+  UploadTicket lastTicket = 0;
+  for (auto &entry : this->loads) {
+    Load &load = *entry.second;
+
+    if (load.state == STATE_DECODED) {
+      this->upload(load);
+    }
+
+    if (load.state == STATE_UPLOADING) {
+      lastTicket = std::max(lastTicket, load.uploadTicket);
+    }
+  }
+
+  if (lastTicket == 0) {
+    return;
+  }
+
+  this->framework->getUploadQueue()->wait(lastTicket);
+
+  for (auto &entry : this->loads) {
+    if (entry.second->state == STATE_UPLOADING) {
+      entry.second->state = STATE_RESIDENT;
+    }
+  }
+}
+
+void TextureLoader::release(TextureHandle handle) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->loads.find(handle);
+  if (it == this->loads.end()) {
+    return;
+  }
+
+  Load &load = *it->second;
+
+  if (load.state == STATE_DECODING) {
+    load.released = true;
+    return;
+  }
+
+  if (load.state == STATE_UPLOADING || load.state == STATE_RESIDENT) {
+    this->framework->getTextureTable()->remove(&load.texture);
+
+    // Its copies may still be recorded in the unflushed upload batch, and
+    // frames in flight may still sample it
+    this->pendingDestroys.push_back({
+        .texture = load.texture,
+        .uploadTicket = load.uploadTicket,
+        .frameNumber = this->framework->getContext()->getFrameNumber(),
+    });
+  }
+
+  this->loads.erase(it);
+}
+
+void TextureLoader::update() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  UploadQueue *uploadQueue = this->framework->getUploadQueue();
+
+  for (auto it = this->loads.begin(); it != this->loads.end();) {
+    Load &load = *it->second;
+
+    if (load.released && load.state != STATE_DECODING) {
+      it = this->loads.erase(it);
+      continue;
+    }
+
+    if (load.state == STATE_DECODED) {
+      this->upload(load);
+    }
+
+    if (load.state == STATE_UPLOADING &&
+        uploadQueue->isComplete(load.uploadTicket)) {
+      load.state = STATE_RESIDENT;
+    }
+
+    ++it;
+  }
+
+  VkContext *context = this->framework->getContext();
+
+  auto pending = this->pendingDestroys.begin();
+  while (pending != this->pendingDestroys.end()) {
+    if (uploadQueue->isComplete(pending->uploadTicket) &&
+        context->isFrameComplete(pending->frameNumber)) {
+      pending->texture.destroy(false);
+      pending = this->pendingDestroys.erase(pending);
+    } else {
+      ++pending;
+    }
+  }
+}
+
+void TextureLoader::decode(Load *load) {
+  bool cancelled = false;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->stopping) {
+      load->state = STATE_FAILED;
+      load->error = "Texture loader was destroyed";
+      cancelled = true;
+    }
+  }
+
+  if (cancelled) {
+    this->decodedCondition.notify_all();
+    return;
+  }
+
+  std::unique_ptr<ImageFile> image;
+  std::unique_ptr<DdsFile> ddsFile;
+  std::string error;
+
+  try {
+    if (DdsFile::isDdsPath(load->path.c_str())) {
+      ddsFile.reset(new DdsFile(load->path.c_str()));
+    } else {
+      image.reset(new ImageFile(load->path.c_str()));
+    }
+  } catch (const std::exception &e) {
+    error = e.what();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (error.empty()) {
+      load->image = std::move(image);
+      load->ddsFile = std::move(ddsFile);
+      load->state = STATE_DECODED;
+    } else {
+      std::cout << "Failed to load texture \"" << load->path << "\": " << error
+                << std::endl;
+      load->error = error;
+      load->state = STATE_FAILED;
+    }
+  }
+
+  this->decodedCondition.notify_all();
+}
+
+void TextureLoader::upload(Load &load) {
+  UploadQueue *uploadQueue = this->framework->getUploadQueue();
+
+  try {
+    if (load.ddsFile) {
+      // Block compressed, with its mips already in the file
+      DdsFile &file = *load.ddsFile;
+
+      load.texture = {
+          this->framework,
+          file.getWidth(),
+          file.getHeight(),
+          file.getFormat(),
+          file.getMipLevels(),
+      };
+
+      load.uploadTicket = uploadQueue->enqueue(
+          load.texture, file.getData(), file.getDataSize(), file.getLevels());
+    } else {
+      ImageFile &image = *load.image;
+
+      load.texture = {this->framework, image.getWidth(), image.getHeight()};
+
+      load.uploadTicket = uploadQueue->enqueue(
+          load.texture, image.getData(), image.getSize());
+    }
+
+    load.state = STATE_UPLOADING;
+  } catch (const std::exception &e) {
+    std::cout << "Failed to upload texture \"" << load.path
+              << "\": " << e.what() << std::endl;
+    load.error = e.what();
+    load.state = STATE_FAILED;
+  }
+
+  // The data was copied into the staging buffer
+  load.image.reset();
+  load.ddsFile.reset();
+}
+
+bool TextureLoader::isDecoding() {
+  for (auto &entry : this->loads) {
+    if (entry.second->state == STATE_DECODING) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../buffer/upload_queue.hpp"
+#include "../thread/thread_pool.hpp"
+#include "texture.hpp"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vkf {
+class Framework;
+class AssetPack;
+class ImageFile;
+class DdsFile;
+
+// Identifies a texture requested from the TextureLoader, 0 is never used
+typedef uint64_t TextureHandle;
+
+// Loads textures in the background. Files are decoded on a pool of worker
+// threads, and the decoded data is handed to the upload queue on the thread
+// that calls update. Until a texture is resident users draw with the
+// loader's placeholder texture instead.
+class TextureLoader {
+public:
+  TextureLoader(Framework *framework);
+  TextureLoader(const TextureLoader &) = delete;
+  TextureLoader &operator=(const TextureLoader &) = delete;
+  ~TextureLoader();
+
+  // Queues a texture file for decoding, DDS files keep their mip levels and
+  // every other format is decoded with stb_image
+  TextureHandle load(const char *path);
+
+  // Records the upload of a texture entry of an asset pack right away, as it
+  // doesn't need decoding
+  TextureHandle load(AssetPack &pack, const char *name);
+
+  // Returns true once the texture finished uploading
+  bool isResident(TextureHandle handle);
+
+  // Returns the texture if it's resident, nullptr otherwise
+  Texture *getTexture(TextureHandle handle);
+
+  // 1x1 white texture, resident once the first update was called
+  Texture *getPlaceholder();
+
+  // Blocks until the texture is resident. Throws if it failed to load.
+  Texture *wait(TextureHandle handle);
+
+  // Blocks until every requested texture is resident or failed to load
+  void waitIdle();
+
+  // Releases the texture, or drops it once decoded if it's still decoding. The
+  // texture is destroyed by a later update, once its upload and the frames
+  // that could sample it finished.
+  void release(TextureHandle handle);
+
+  // Hands decoded textures to the upload queue, checks for finished uploads
+  // and destroys released textures the GPU is done with. Called by
+  // Framework::update.
+  void update();
+
+private:
+  Framework *framework{nullptr};
+
+  enum State {
+    STATE_DECODING,
+    STATE_DECODED,
+    STATE_UPLOADING,
+    STATE_RESIDENT,
+    STATE_FAILED,
+  };
+
+  struct Load {
+    std::string path;
+    State state = STATE_DECODING;
+
+    // Decoded data, only one of them is set. Freed once staged.
+    std::unique_ptr<ImageFile> image;
+    std::unique_ptr<DdsFile> ddsFile;
+    std::string error;
+
+    Texture texture;
+    UploadTicket uploadTicket = 0;
+
+    // Released while decoding, erased once the worker is done with it
+    bool released = false;
+  };
+
+  std::mutex mutex;
+  // Signaled whenever a worker finishes decoding
+  std::condition_variable decodedCondition;
+
+  std::map<TextureHandle, std::unique_ptr<Load>> loads;
+  TextureHandle nextHandle = 1;
+
+  struct PendingDestroy {
+    Texture texture;
+    // Batch that uploads the texture, it may not even be submitted yet
+    UploadTicket uploadTicket;
+    // Frame that was being recorded when the texture was released
+    uint64_t frameNumber;
+  };
+
+  // Released textures that uploads or frames in flight could still use
+  std::vector<PendingDestroy> pendingDestroys;
+
+  Texture placeholder;
+
+  // Set on destruction, so queued decodes are skipped
+  bool stopping = false;
+
+  // Decodes a file on a worker thread
+  void decode(Load *load);
+
+  // Creates the texture of a decoded load and records its upload. Must be
+  // called with the mutex locked.
+  void upload(Load &load);
+
+  // Returns true if a worker is still decoding a load. Must be called with
+  // the mutex locked.
+  bool isDecoding();
+
+  // Declared last so its workers are joined before anything else is
+  // destroyed
+  ThreadPool threadPool;
+};
+} // namespace vkf
@@ -0,0 +1,215 @@
+#include "texture_table.hpp"
+#include "../framework/framework.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace vkf;
+
+// Resources of the fragment stage besides the table, e.g. its color
+// attachment, which count towards the same update after bind limits
+const uint32_t TEXTURE_TABLE_RESERVED_RESOURCES = 8;
+
+TextureTable::TextureTable(Framework *framework) : framework(framework) {
+  VkContext *context = this->framework->getContext();
+  if (!context->isBindlessSupported()) {
+    return;
+  }
+
+  uint32_t maxTextures = context->getMaxBindlessTextures();
+  if (maxTextures <= TEXTURE_TABLE_RESERVED_RESOURCES) {
+    return;
+  }
+
+  this->capacity = std::min(
+      MAX_BINDLESS_TEXTURES, maxTextures - TEXTURE_TABLE_RESERVED_RESOURCES);
+
+  VkDescriptorSetLayoutBinding layoutBinding = {
+      .binding = 0,
+      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .descriptorCount = this->capacity,
+      .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+      .pImmutableSamplers = nullptr,
+  };
+
+  // Slots are written while the set is bound by frames in flight, and the
+  // ones without a texture are never read
+  VkDescriptorBindingFlagsEXT bindingFlags =
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo = {
+      .sType =
+          VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
+      .pNext = nullptr,
+      .bindingCount = 1,
+      .pBindingFlags = &bindingFlags,
+  };
+
+  VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .pNext = &bindingFlagsCreateInfo,
+      .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT,
+      .bindingCount = 1,
+      .pBindings = &layoutBinding,
+  };
+
+  if (vkCreateDescriptorSetLayout(
+          context->getDevice(),
+          &descriptorSetLayoutCreateInfo,
+          nullptr,
+          &this->descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create texture table set layout");
+  }
+
+  VkDescriptorPoolSize poolSize = {
+      .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .descriptorCount = this->capacity,
+  };
+
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT,
+      .maxSets = 1,
+      .poolSizeCount = 1,
+      .pPoolSizes = &poolSize,
+  };
+
+  if (vkCreateDescriptorPool(
+          context->getDevice(),
+          &descriptorPoolCreateInfo,
+          nullptr,
+          &this->descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create texture table pool");
+  }
+
+  VkDescriptorSetAllocateInfo allocateInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .descriptorPool = this->descriptorPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &this->descriptorSetLayout,
+  };
+
+  if (vkAllocateDescriptorSets(
+          context->getDevice(), &allocateInfo, &this->descriptorSet) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate texture table set");
+  }
+
+  this->enabled = true;
+}
+
+void TextureTable::destroy() {
+  VkDevice device = this->framework->getContext()->getDevice();
+  if (device == VK_NULL_HANDLE) {
+    return;
+  }
+
+  vkDeviceWaitIdle(device);
+
+  if (this->descriptorPool != VK_NULL_HANDLE) {
+    vkDestroyDescriptorPool(device, this->descriptorPool, nullptr);
+    this->descriptorPool = VK_NULL_HANDLE;
+    this->descriptorSet = VK_NULL_HANDLE;
+  }
+
+  if (this->descriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(device, this->descriptorSetLayout, nullptr);
+    this->descriptorSetLayout = VK_NULL_HANDLE;
+  }
+
+  this->enabled = false;
+}
+
+bool TextureTable::isEnabled() const {
+  return this->enabled;
+}
+
+VkDescriptorSetLayout TextureTable::getDescriptorSetLayout() {
+  return this->descriptorSetLayout;
+}
+
+VkDescriptorSet TextureTable::getDescriptorSet() {
+  return this->descriptorSet;
+}
+
+uint32_t TextureTable::getIndex(Texture *texture) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->indices.find(texture->getImageViewHandle());
+  if (it != this->indices.end()) {
+    return it->second;
+  }
+
+  uint32_t index;
+  if (!this->freeIndices.empty()) {
+    index = this->freeIndices.back();
+    this->freeIndices.pop_back();
+  } else if (this->nextIndex < this->capacity) {
+    index = this->nextIndex++;
+  } else {
+    throw std::runtime_error("Texture table is full");
+  }
+
+  this->indices[texture->getImageViewHandle()] = index;
+
+  VkDescriptorImageInfo imageInfo = {
+      .sampler = texture->getSamplerHandle(),
+      .imageView = texture->getImageViewHandle(),
+      .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+  };
+
+  VkWriteDescriptorSet descriptorWrite{
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .pNext = nullptr,
+      .dstSet = this->descriptorSet,
+      .dstBinding = 0,
+      .dstArrayElement = index,
+      .descriptorCount = 1,
+      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .pImageInfo = &imageInfo,
+      .pBufferInfo = nullptr,
+      .pTexelBufferView = nullptr,
+  };
+
+  vkUpdateDescriptorSets(
+      this->framework->getContext()->getDevice(),
+      1,
+      &descriptorWrite,
+      0,
+      nullptr);
+
+  return index;
+}
+
+void TextureTable::remove(Texture *texture) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->indices.find(texture->getImageViewHandle());
+  if (it == this->indices.end()) {
+    return;
+  }
+
+  this->pendingFrees.push_back({
+      .index = it->second,
+      .frameNumber = this->framework->getContext()->getFrameNumber(),
+  });
+
+  this->indices.erase(it);
+}
+
+void TextureTable::update() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  VkContext *context = this->framework->getContext();
+
+  auto it = this->pendingFrees.begin();
+  while (it != this->pendingFrees.end() &&
+         context->isFrameComplete(it->frameNumber)) {
+    this->freeIndices.push_back(it->index);
+    ++it;
+  }
+
+  this->pendingFrees.erase(this->pendingFrees.begin(), it);
+}
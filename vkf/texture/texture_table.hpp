@@ -0,0 +1,75 @@
+#pragma once
+
+#include "texture.hpp"
+#include <map>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkf {
+class Framework;
+
+// Upper bound for the number of textures in the table, lowered to what the
+// device supports
+const uint32_t MAX_BINDLESS_TEXTURES = 16 * 1024;
+
+// Global array of textures that shaders index with a per draw texture index,
+// so draws with different textures don't need different descriptor sets.
+// Needs VK_EXT_descriptor_indexing. If the device doesn't support it the
+// table is disabled, and materials keep a descriptor set per texture.
+class TextureTable {
+public:
+  TextureTable(Framework *framework);
+  TextureTable(const TextureTable &) = delete;
+  TextureTable &operator=(const TextureTable &) = delete;
+  ~TextureTable(){};
+
+  void destroy();
+
+  bool isEnabled() const;
+
+  // Layout of the table's set, a single array of combined image samplers at
+  // binding 0
+  VkDescriptorSetLayout getDescriptorSetLayout();
+  VkDescriptorSet getDescriptorSet();
+
+  // Returns the texture's index into the array. The first time a texture is
+  // asked for it's written into a free slot, which it keeps until removed.
+  uint32_t getIndex(Texture *texture);
+
+  // Frees the texture's slot, must be called before a texture that was
+  // indexed is destroyed. The slot is reused once the frames in flight are
+  // done with it.
+  void remove(Texture *texture);
+
+  // Makes freed slots available again, should be called once per frame
+  void update();
+
+private:
+  Framework *framework{nullptr};
+
+  bool enabled = false;
+  uint32_t capacity = 0;
+
+  VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+  VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+  VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+
+  // Slot of every indexed texture, keyed by its image view
+  std::map<VkImageView, uint32_t> indices;
+  std::vector<uint32_t> freeIndices;
+  // Slots at and after this one were never used
+  uint32_t nextIndex = 0;
+
+  struct PendingFree {
+    uint32_t index;
+    uint64_t frameNumber;
+  };
+
+  // Slots removed while frames in flight could still sample them
+  std::vector<PendingFree> pendingFrees;
+
+  // Meshes may ask for indices while drawing in parallel
+  std::mutex mutex;
+};
+} // namespace vkf
@@ -0,0 +1,93 @@
+#include "thread_pool.hpp"
+#include <exception>
+
+using namespace vkf;
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = 1;
+  }
+
+  for (uint32_t i = 0; i < threadCount; i++) {
+    this->threads.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->condition.notify_all();
+
+  for (auto &thread : this->threads) {
+    thread.join();
+  }
+}
+
+uint32_t ThreadPool::getThreadCount() const {
+  return static_cast<uint32_t>(this->threads.size());
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->tasks.push_back(std::move(task));
+  }
+  this->condition.notify_one();
+}
+
+void ThreadPool::parallelFor(
+    uint32_t count, std::function<void(uint32_t)> function) {
+  std::mutex doneMutex;
+  std::condition_variable doneCondition;
+  uint32_t remaining = count;
+  std::exception_ptr exception;
+
+  for (uint32_t i = 0; i < count; i++) {
+    this->enqueue([&, i]() {
+      std::exception_ptr taskException;
+      try {
+        function(i);
+      } catch (...) {
+        taskException = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(doneMutex);
+      if (taskException && !exception) {
+        exception = taskException;
+      }
+      if (--remaining == 0) {
+        doneCondition.notify_one();
+      }
+    });
+  }
+
+  std::unique_lock<std::mutex> lock(doneMutex);
+  doneCondition.wait(lock, [&]() { return remaining == 0; });
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(
+          lock, [this]() { return this->stopping || !this->tasks.empty(); });
+
+      if (this->stopping && this->tasks.empty()) {
+        return;
+      }
+
+      task = std::move(this->tasks.front());
+      this->tasks.pop_front();
+    }
+
+    task();
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vkf {
+class ThreadPool {
+public:
+  ThreadPool(uint32_t threadCount);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  uint32_t getThreadCount() const;
+
+  // Queues a task to run on one of the worker threads
+  void enqueue(std::function<void()> task);
+
+  // Calls function(i) for every i in [0, count) on the worker threads and
+  // waits for all of them to finish. Rethrows the first exception thrown.
+  void parallelFor(uint32_t count, std::function<void(uint32_t)> function);
+
+private:
+  std::vector<std::thread> threads;
+
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+
+  void work();
+};
+} // namespace vkf
@@ -1,9 +1,18 @@
 #pragma once
 
+#include "asset/asset_pack.hpp"
 #include "camera/camera.hpp"
+#include "culling/culling_set.hpp"
 #include "framework/framework.hpp"
+#include "material/batch_material.hpp"
+#include "material/compute_pipeline.hpp"
+#include "material/descriptor_allocator.hpp"
+#include "material/instanced_material.hpp"
 #include "material/standard_material.hpp"
 #include "mesh/mesh.hpp"
+#include "renderer/batch_renderer.hpp"
+#include "renderer/render_queue.hpp"
+#include "renderer/timeline_semaphore.hpp"
 #include "renderer/vk_context.hpp"
 #include "window/event_handler.hpp"
 #include "window/keycode.hpp"
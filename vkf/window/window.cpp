@@ -15,23 +15,58 @@ Window::Window(const char *title, int width, int height) {
       SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN);
 }
 
+Window::Window(int width, int height)
+    : headless(true),
+      width(static_cast<uint32_t>(width)),
+      height(static_cast<uint32_t>(height)) {
+  SDL_Init(SDL_INIT_EVENTS | SDL_INIT_TIMER);
+}
+
 Window::~Window() {
-  SDL_DestroyWindow(this->window);
+  if (this->window != nullptr) {
+    SDL_DestroyWindow(this->window);
+  }
   SDL_Quit();
 }
 
 uint32_t Window::getWidth() const {
+  if (this->headless) {
+    return this->width;
+  }
+
   int width;
   SDL_GetWindowSize(window, &width, nullptr);
   return static_cast<uint32_t>(width);
 }
 
 uint32_t Window::getHeight() const {
+  if (this->headless) {
+    return this->height;
+  }
+
   int height;
   SDL_GetWindowSize(window, nullptr, &height);
   return static_cast<uint32_t>(height);
 }
 
+bool Window::isHeadless() const {
+  return this->headless;
+}
+
+void Window::setSize(uint32_t width, uint32_t height) {
+  if (this->headless) {
+    this->width = width;
+    this->height = height;
+  } else {
+    SDL_SetWindowSize(
+        this->window, static_cast<int>(width), static_cast<int>(height));
+  }
+
+  for (EventHandler *handler : this->eventHandlers) {
+    handler->onResize(width, height);
+  }
+}
+
 void Window::setRelativeMouse(bool relative) {
   SDL_SetRelativeMouseMode(relative ? SDL_TRUE : SDL_FALSE);
 }
@@ -116,6 +151,10 @@ void Window::pollEvents() {
 }
 
 std::vector<const char *> Window::getVulkanExtensions() {
+  if (this->headless) {
+    return {};
+  }
+
   uint32_t sdlExtensionCount = 0;
   SDL_Vulkan_GetInstanceExtensions(this->window, &sdlExtensionCount, nullptr);
   std::vector<const char *> sdlExtensions(sdlExtensionCount);
@@ -125,6 +164,10 @@ std::vector<const char *> Window::getVulkanExtensions() {
 }
 
 void Window::createVulkanSurface(VkInstance instance, VkSurfaceKHR *surface) {
+  if (this->headless) {
+    throw std::runtime_error("Headless windows don't have a surface");
+  }
+
   if (!SDL_Vulkan_CreateSurface(window, instance, surface)) {
     throw std::runtime_error("Failed to create window surface");
   }
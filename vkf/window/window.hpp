@@ -17,6 +17,10 @@ class Window {
 
 public:
   Window(const char *title, int width, int height);
+
+  // Creates a headless window, which has no SDL window or Vulkan surface.
+  // Rendering goes to offscreen images instead.
+  Window(int width, int height);
   Window(const Window &) = delete;
   Window &operator=(const Window &) = delete;
   ~Window();
@@ -24,6 +28,11 @@ public:
   uint32_t getWidth() const;
   uint32_t getHeight() const;
 
+  bool isHeadless() const;
+
+  // Resizes the window and notifies the event handlers
+  void setSize(uint32_t width, uint32_t height);
+
   void setRelativeMouse(bool relative);
   bool getRelativeMouse();
   void getRelativeMousePos(int *x, int *y);
@@ -42,12 +51,17 @@ public:
   void removeHandler(EventHandler *eventHandler);
 
 private:
-  SDL_Window *window;
+  SDL_Window *window{nullptr};
+
+  bool headless = false;
+  // Size of a headless window
+  uint32_t width = 0;
+  uint32_t height = 0;
 
   bool shouldClose = false;
 
-  int previousTime;
-  int deltaTime;
+  int previousTime = 0;
+  int deltaTime = 0;
 
   std::list<EventHandler *> eventHandlers;
 };